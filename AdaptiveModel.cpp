@@ -0,0 +1,90 @@
+/**
+ * @file AdaptiveModel.cpp - A Huffman model that follows drifting text, rebuilt in the background.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <array>
+#include <stdexcept>
+#include "AdaptiveModel.h"
+#include "CompressibilityProbe.h"
+using namespace std;
+
+AdaptiveModel::AdaptiveModel(const uint64_t initial[], size_t window, double threshold)
+        : window(window), threshold(threshold), seen(0), lastDrift(0), installed(1),
+          model(build(initial)), rebuilder(), rebuilding(false), ready(false), pendingLock(), pending() {
+    if (window == 0)
+        throw invalid_argument("drift window must be positive");
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++) {
+        counts[c] = initial[c];
+        recent[c] = 0;
+    }
+}
+
+AdaptiveModel::~AdaptiveModel() {
+    if (rebuilder.joinable())
+        rebuilder.join();
+}
+
+shared_ptr<const Huffman> AdaptiveModel::build(const uint64_t counts[]) {
+    uint64_t frequencies[Huffman::MAX_CHAR+1];
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        frequencies[c] = counts[c] + 1;
+    return make_shared<const Huffman>(frequencies);
+}
+
+void AdaptiveModel::observe(const uint8_t *text, size_t n) {
+    while (n > 0) {
+        size_t take = window - seen < n ? window - seen : n;
+        for (size_t i = 0; i < take; i++)
+            recent[text[i]]++;
+        text += take;
+        n -= take;
+        seen += take;
+        if (seen == window)
+            endWindow();
+    }
+}
+
+void AdaptiveModel::endWindow() {
+    uint64_t currentBits = CompressibilityProbe::huffmanBits(recent, *model);
+    uint64_t ownBits = CompressibilityProbe::huffmanBits(recent);
+    lastDrift = ownBits == 0 ? 0 : ((double)currentBits - (double)ownBits) / (double)ownBits;
+
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++) {
+        counts[c] = counts[c] / 2 + recent[c];
+        recent[c] = 0;
+    }
+    seen = 0;
+
+    if (lastDrift > threshold && !rebuilding) {
+        if (rebuilder.joinable())
+            rebuilder.join();  // finished long ago: its model was installed by swap()
+        rebuilding = true;
+        array<uint64_t, Huffman::MAX_CHAR+1> snapshot;
+        for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+            snapshot[c] = counts[c];
+        rebuilder = thread([this, snapshot]() {
+            shared_ptr<const Huffman> rebuilt = build(snapshot.data());
+            {
+                lock_guard<mutex> guard(pendingLock);
+                pending = rebuilt;
+            }
+            ready = true;
+        });
+    }
+}
+
+bool AdaptiveModel::swap() {
+    if (!ready)
+        return false;
+    {
+        lock_guard<mutex> guard(pendingLock);
+        model = pending;
+        pending.reset();
+    }
+    ready = false;
+    rebuilding = false;
+    installed++;
+    return true;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file AdaptiveModel.h - A Huffman model that follows drifting text, rebuilt in the background.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "Huffman.h"
+
+/**
+ * @class AdaptiveModel - keeps a Huffman model up to date with the text being coded.
+ *
+ * The encoder codes each block with current(), then folds the block into the counts with
+ * observe(). Once every window characters, observe() compares the bits the current codes
+ * spend on the window with the bits the window's own Huffman codes would (the drift). If
+ * the current codes waste more than the threshold, new codes are built from the counts on a
+ * background thread, so the encoder never waits for them, and the next swap() after they
+ * are ready installs them. swap() is meant to be called between blocks, so every block is
+ * coded with a single model.
+ *
+ * The counts age: at the end of each window they are halved before the window is added, so
+ * they mostly describe the last few windows. Every character keeps a count of at least one
+ * in the models built, so any text can be coded with any of them.
+ *
+ * A decoder follows along without an AdaptiveModel of its own: Pipeline writes a MODEL
+ * frame (BlockCodec::encodeModel()) whenever swap() installs new codes.
+ *
+ * The methods are meant to be called from a single (coding) thread; only the rebuilding
+ * happens elsewhere.
+ */
+class AdaptiveModel {
+public:
+    static const size_t DEFAULT_WINDOW = 256 * 1024;
+    static constexpr double DEFAULT_THRESHOLD = 0.03;
+
+    /**
+     * @param initial    counts for the first model (zeros are allowed)
+     * @param window     characters observed between drift checks
+     * @param threshold  rebuild once the current codes take this fraction more bits than the
+     *                   window's own codes would
+     */
+    explicit AdaptiveModel(const uint64_t initial[], size_t window = DEFAULT_WINDOW,
+                           double threshold = DEFAULT_THRESHOLD);
+
+    // big 5 (owns a thread, so neither copying nor moving is allowed)
+    ~AdaptiveModel();
+    AdaptiveModel(const AdaptiveModel& other) = delete;
+    AdaptiveModel(AdaptiveModel&& temp) = delete;
+    AdaptiveModel& operator=(const AdaptiveModel& other) = delete;
+    AdaptiveModel& operator=(AdaptiveModel&& temp) = delete;
+
+    /**
+     * The model to code the next block with. It stays valid while the pointer is held.
+     */
+    std::shared_ptr<const Huffman> current() const {
+        return model;
+    }
+
+    /**
+     * Fold coded text into the counts, and start a rebuild if the codes have drifted.
+     */
+    void observe(const uint8_t *text, size_t n);
+
+    /**
+     * Install the rebuilt model if one is ready (never waits for one that isn't).
+     *
+     * @return  true if current() changed
+     */
+    bool swap();
+
+    /**
+     * Number of models installed so far, counting the first.
+     */
+    uint64_t generation() const {
+        return installed;
+    }
+
+    /**
+     * Drift measured at the last window: extra bits of the current codes over the window's
+     * own codes, as a fraction of the latter.
+     */
+    double drift() const {
+        return lastDrift;
+    }
+
+private:
+    size_t window;
+    double threshold;
+    uint64_t counts[Huffman::MAX_CHAR+1];  // aged counts of everything observed
+    uint64_t recent[Huffman::MAX_CHAR+1];  // counts of the window so far
+    size_t seen;                           // characters in the window so far
+    double lastDrift;
+    uint64_t installed;
+    std::shared_ptr<const Huffman> model;
+
+    std::thread rebuilder;
+    std::atomic<bool> rebuilding;          // rebuilder is running or its result not yet installed
+    std::atomic<bool> ready;               // rebuilder has finished and left its model in pending
+    std::mutex pendingLock;
+    std::shared_ptr<const Huffman> pending;
+
+    /**
+     * A model for counts, with every character given at least a count of one.
+     */
+    static std::shared_ptr<const Huffman> build(const uint64_t counts[]);
+
+    /**
+     * Check the finished window for drift, age the counts and maybe start a rebuild.
+     */
+    void endWindow();
+};
@@ -0,0 +1,209 @@
+/**
+ * @file AlphabeticCode.cpp - Order-preserving (Garsia-Wachs) codes for compressed sort keys.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include "AlphabeticCode.h"
+using namespace std;
+
+AlphabeticCode::AlphabeticCode(const uint64_t frequencies[], uint64_t keys) {
+    counts[TERMINATOR] = keys > 0 ? keys : 1;
+    for (int c = 0; c <= MAX_CHAR; c++)
+        counts[c + 1] = frequencies[c];
+    build();
+}
+
+AlphabeticCode::AlphabeticCode(const vector<string>& sample) {
+    counts[TERMINATOR] = sample.empty() ? 1 : sample.size();
+    for (int c = 0; c <= MAX_CHAR; c++)
+        counts[c + 1] = 0;
+    for (const string& key: sample)
+        for (char c: key)
+            counts[(unsigned char)c + 1]++;
+    build();
+}
+
+/*
+ * File layout: the terminator's count, then the count of each character 0..MAX_CHAR (uint64).
+ */
+void AlphabeticCode::writeToFile(string filename) const {
+    ofstream f;
+    f.open(filename, ios::binary | ios::out);
+    if (!f.is_open())
+        throw invalid_argument(string("cannot open file ") + filename + " to write alphabetic code");
+    f.write((const char *)counts, sizeof(counts));
+}
+
+AlphabeticCode::AlphabeticCode(string filename) {
+    ifstream f;
+    f.open(filename, ios::binary | ios::in);
+    if (!f.is_open())
+        throw invalid_argument(string("cannot open file ") + filename + " to read alphabetic code");
+    if (!f.read((char *)counts, sizeof(counts)))
+        throw invalid_argument(string("file ") + filename + " ended early");
+    build();
+}
+
+void AlphabeticCode::build() {
+    vector<int> symbols;  // the symbols with codes, in order
+    vector<uint64_t> weights;
+    for (int s = 0; s < SYMBOLS; s++) {
+        lengths[s] = 0;
+        codes[s] = 0;
+        if (counts[s] != 0 || s == TERMINATOR) {
+            symbols.push_back(s);
+            weights.push_back(counts[s] != 0 ? counts[s] : 1);
+        }
+    }
+    if (symbols.size() < 2)
+        throw invalid_argument("no characters to code");
+
+    // as in Huffman::buildCodeTree, very skewed counts are halved until the codes fit
+    vector<int> depths;
+    for (;;) {
+        alphabeticDepths(weights, depths);
+        int deepest = 0;
+        for (int d: depths)
+            deepest = max(deepest, d);
+        if (deepest <= MAX_LENGTH)
+            break;
+        for (uint64_t& w: weights)
+            w = w / 2 + 1;
+    }
+
+    // the leaves are in order, so each code is the one after the previous, at its own depth
+    uint64_t code = 0;
+    for (size_t i = 0; i < symbols.size(); i++) {
+        if (i > 0) {
+            code++;
+            if (depths[i] >= depths[i - 1]) {
+                code <<= depths[i] - depths[i - 1];
+            } else {
+                int drop = depths[i - 1] - depths[i];
+                if (code & ((uint64_t(1) << drop) - 1))
+                    throw logic_error("alphabetic code depths do not form a tree");
+                code >>= drop;
+            }
+        }
+        codes[symbols[i]] = (uint32_t)code;
+        lengths[symbols[i]] = (uint8_t)depths[i];
+    }
+
+    tree.assign(2, 0);
+    for (int s: symbols) {
+        size_t node = 0;
+        for (int b = lengths[s] - 1; b > 0; b--) {
+            size_t branch = 2 * node + ((codes[s] >> b) & 1u);
+            if (tree[branch] == 0) {
+                tree[branch] = (uint16_t)(tree.size() / 2);
+                tree.resize(tree.size() + 2, 0);
+            }
+            node = tree[branch];
+        }
+        tree[2 * node + (codes[s] & 1u)] = (uint16_t)(LEAF | s);
+    }
+}
+
+/*
+ * Garsia-Wachs in its plain O(n^2) form, which is plenty for 257 symbols:
+ * 1. Repeatedly take the leftmost pair of neighbours (x, y) with x no heavier than the
+ *    weight after y, combine them, and move the combined weight left past every lighter
+ *    weight. The tree this builds is not alphabetic, but its leaf depths are optimal.
+ * 2. Read each original weight's depth off that tree; the caller turns the depths into
+ *    an alphabetic tree by assigning codes in order.
+ */
+void AlphabeticCode::alphabeticDepths(const vector<uint64_t>& weights, vector<int>& depths) {
+    size_t n = weights.size();
+    vector<pair<int, int>> children(n, make_pair(-1, -1));  // leaves first, then combined nodes
+    vector<pair<uint64_t, int>> row;                          // (weight, node)
+    for (size_t i = 0; i < n; i++)
+        row.push_back(make_pair(weights[i], (int)i));
+
+    while (row.size() > 1) {
+        size_t k = 1;
+        while (k + 1 < row.size() && row[k - 1].first > row[k + 1].first)
+            k++;
+        uint64_t combined = row[k - 1].first + row[k].first;
+        children.push_back(make_pair(row[k - 1].second, row[k].second));
+        row.erase(row.begin() + (k - 1), row.begin() + (k + 1));
+        size_t j = k - 1;  // insert after the nearest weight to the left at least as heavy
+        while (j > 0 && row[j - 1].first < combined)
+            j--;
+        row.insert(row.begin() + j, make_pair(combined, (int)children.size() - 1));
+    }
+
+    depths.assign(n, 0);
+    vector<pair<int, int>> stack(1, make_pair(row[0].second, 0));  // (node, depth)
+    while (!stack.empty()) {
+        pair<int, int> top = stack.back();
+        stack.pop_back();
+        if ((size_t)top.first < n) {
+            depths[top.first] = top.second;
+        } else {
+            stack.push_back(make_pair(children[top.first].first, top.second + 1));
+            stack.push_back(make_pair(children[top.first].second, top.second + 1));
+        }
+    }
+}
+
+size_t AlphabeticCode::encode(const uint8_t *key, size_t n, uint8_t *dst, size_t cap) const {
+    uint64_t pending = 0;  // bits not yet written, the first of them most significant
+    int count = 0;
+    size_t out = 0;
+    for (size_t i = 0; i <= n; i++) {
+        int symbol = i < n ? key[i] + 1 : TERMINATOR;
+        int length = lengths[symbol];
+        if (length == 0)
+            throw invalid_argument("character not in the sample: " + to_string(key[i]));
+        pending = (pending << length) | codes[symbol];
+        count += length;
+        while (count >= 8) {
+            if (out == cap)
+                throw length_error("coded key does not fit");
+            count -= 8;
+            dst[out++] = (uint8_t)(pending >> count);
+        }
+    }
+    if (count > 0) {
+        if (out == cap)
+            throw length_error("coded key does not fit");
+        dst[out++] = (uint8_t)(pending << (8 - count));
+    }
+    return out;
+}
+
+string AlphabeticCode::encode(const string& key) const {
+    string coded(encodedBound(key.size()), '\0');
+    coded.resize(encode((const uint8_t *)key.data(), key.size(), (uint8_t *)&coded[0], coded.size()));
+    return coded;
+}
+
+size_t AlphabeticCode::decode(const uint8_t *src, size_t bytes, string& key) const {
+    key.clear();
+    uint16_t node = 0;
+    for (size_t bit = 0; bit < 8 * bytes; bit++) {
+        node = tree[2 * node + ((src[bit / 8] >> (7 - bit % 8)) & 1u)];
+        if (node == 0)
+            throw invalid_argument("not an alphabetic code");
+        if (!(node & LEAF))
+            continue;
+        int symbol = node & ~LEAF;
+        if (symbol == TERMINATOR)
+            return bit / 8 + 1;
+        key += (char)(symbol - 1);
+        node = 0;
+    }
+    throw invalid_argument("coded key ended early");
+}
+
+string AlphabeticCode::decode(const string& coded) const {
+    string key;
+    if (decode((const uint8_t *)coded.data(), coded.size(), key) != coded.size())
+        throw invalid_argument("coded key has trailing bytes");
+    return key;
+}
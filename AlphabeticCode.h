@@ -0,0 +1,149 @@
+/**
+ * @file AlphabeticCode.h - Order-preserving (Garsia-Wachs) codes for compressed sort keys.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Bits.h"
+
+/**
+ * @class AlphabeticCode - compresses keys so that the compressed keys sort like the keys.
+ *
+ * A Huffman tree puts its characters in any order, so coded keys can't be compared without
+ * decoding them. Here the tree is alphabetic: its leaves are in character order (0 to 255,
+ * as unsigned bytes), so if a < b then every code of a is less than every code of b. The
+ * tree is the optimal alphabetic one for the frequencies (Garsia-Wachs), usually within a
+ * few percent of the Huffman size.
+ *
+ * Each key is coded followed by a terminator, a symbol that sorts before every character,
+ * and packed first bit into the most significant bit of the first byte (unlike the rest of
+ * this library, which packs from the least significant bit) with the last byte padded with
+ * zeros. So for any two keys
+ *     compare(encode(a), encode(b)) has the sign of a.compare(b)
+ * where compare is memcmp over the shorter length (two different keys always differ within
+ * it), or plain std::string comparison. Coded keys can therefore be sorted, binary searched
+ * and range partitioned without decoding any of them.
+ *
+ * As with Huffman, only characters with a non-zero frequency have codes.
+ */
+class AlphabeticCode {
+public:
+    static const int MAX_CHAR = 255;
+    static const int MAX_LENGTH = Bits::MAX_BITS;
+
+    /**
+     * Build the codes from character counts.
+     *
+     * @param frequencies  observation count of each character 0..MAX_CHAR
+     * @param keys         number of keys counted (the terminator's count); 0 is taken as 1
+     * @throws invalid_argument  if every frequency is zero
+     */
+    AlphabeticCode(const uint64_t frequencies[], uint64_t keys);
+
+    /**
+     * Build the codes from a sample of keys.
+     *
+     * @param sample  keys whose characters are counted
+     * @throws invalid_argument  if the sample has no characters
+     */
+    explicit AlphabeticCode(const std::vector<std::string>& sample);
+
+    /**
+     * Load codes from a previously saved file (via writeToFile).
+     * @param filename  path to file previously saved via writeToFile() method
+     */
+    explicit AlphabeticCode(std::string filename);
+
+    /**
+     * Write the counts out to the given file, from which the same codes are rebuilt.
+     * @param filename  name of the file to write (will overwrite any existing file of the same name)
+     */
+    void writeToFile(std::string filename) const;
+
+    /**
+     * Code one key into a caller-owned buffer.
+     *
+     * @param key  the key's characters
+     * @param n    number of characters in key
+     * @param dst  receives the coded key
+     * @param cap  bytes available in dst (encodedBound(n) is always enough)
+     * @return     number of bytes written
+     * @throws invalid_argument  if key has a character without a code
+     * @throws length_error      if dst is too small
+     */
+    size_t encode(const uint8_t *key, size_t n, uint8_t *dst, size_t cap) const;
+
+    /**
+     * Code one key.
+     * @throws invalid_argument  if key has a character without a code
+     */
+    std::string encode(const std::string& key) const;
+
+    /**
+     * Decode the coded key at the front of a buffer.
+     *
+     * @param src    a coded key, possibly followed by others
+     * @param bytes  bytes available in src
+     * @param key    receives the key
+     * @return       number of bytes the coded key took
+     * @throws invalid_argument  if src does not start with a whole coded key
+     */
+    size_t decode(const uint8_t *src, size_t bytes, std::string& key) const;
+
+    /**
+     * Decode one coded key.
+     * @throws invalid_argument  if coded is not exactly one coded key
+     */
+    std::string decode(const std::string& coded) const;
+
+    /**
+     * Largest number of bytes encode() can write for a key of n characters.
+     */
+    size_t encodedBound(size_t n) const {
+        return (size_t)(((uint64_t)(n + 1) * MAX_LENGTH + 7) / 8);
+    }
+
+    /**
+     * Length in bits of c's code (0 if c has none).
+     */
+    int codeLength(unsigned char c) const {
+        return lengths[c + 1];
+    }
+
+    /**
+     * Length in bits of the terminator's code.
+     */
+    int terminatorLength() const {
+        return lengths[TERMINATOR];
+    }
+
+private:
+    static const int TERMINATOR = 0;       // symbol 0; character c is symbol c+1
+    static const int SYMBOLS = MAX_CHAR + 2;
+
+    uint64_t counts[SYMBOLS];  // the counts the codes were built from
+    uint32_t codes[SYMBOLS];   // code of each symbol, right-aligned, first bit most significant
+    uint8_t lengths[SYMBOLS];  // 0 for symbols without a code
+
+    /*
+     * The decoding tree: node i's children are tree[2*i] and tree[2*i+1], each either
+     * LEAF|symbol or the index of another node. Zero (the root) marks a missing branch.
+     */
+    static const uint16_t LEAF = 0x8000;
+    std::vector<uint16_t> tree;
+
+    /**
+     * Build codes, lengths and tree from counts.
+     */
+    void build();
+
+    /**
+     * Garsia-Wachs: the depth in an optimal alphabetic tree of each of n weights, in order.
+     */
+    static void alphabeticDepths(const std::vector<uint64_t>& weights, std::vector<int>& depths);
+};
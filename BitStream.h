@@ -6,6 +6,9 @@
 
 #pragma once
 #include <iostream>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
 
 class BitStream {
 public:
@@ -17,6 +20,52 @@ public:
 
     virtual BitStream *copy() const = 0;
 
+    /*
+     * Multi-bit operations. Bits move lowest-order first, so putBits(v, n) followed by
+     * peekBits(n) gives back the n low bits of v. Built on dequeue, size(), peekBits() and
+     * appendTo() would each copy the whole stream, so every implementation supplies them.
+     * putBits() and consumeBits() default to a bit at a time; implementations override them
+     * to move up to 64 bits at once.
+     */
+
+    /**
+     * Number of bits currently in the stream.
+     */
+    virtual size_t size() const = 0;
+
+    /**
+     * Enqueue the n low-order bits of value, lowest first.
+     * @pre  0 <= n <= 64
+     */
+    virtual void putBits(uint64_t value, int n) {
+        for (int i = 0; i < n; i++)
+            enqueue((value >> i) & 1u);
+    }
+
+    /**
+     * Look at the next n bits without dequeueing them; the next bit is the lowest-order bit
+     * of the result and any bits past the end of the stream are zeros.
+     * @pre  0 <= n <= 64
+     */
+    virtual uint64_t peekBits(int n) const = 0;
+
+    /**
+     * Dequeue and discard the next n bits.
+     * @throws out_of_range  if there are fewer than n bits
+     */
+    virtual void consumeBits(int n) {
+        for (int i = 0; i < n; i++) {
+            if (empty())
+                throw std::out_of_range("cannot consume past the end of a bit stream");
+            dequeue();
+        }
+    }
+
+    /**
+     * Enqueue a copy of all of this stream's bits onto out, leaving this stream unchanged.
+     */
+    virtual void appendTo(BitStream& out) const = 0;
+
     virtual std::ostream& drain(std::ostream& out) {
         while (!empty())
             out << (dequeue() ? '1' : '0');
@@ -24,14 +73,16 @@ public:
     }
 
     virtual void append(BitStream& bits) {
-        while (!bits.empty())
-            enqueue(bits.dequeue());
+        for (size_t n = bits.size(); n > 0; ) {
+            int chunk = n < 64 ? (int)n : 64;
+            putBits(bits.peekBits(chunk), chunk);
+            bits.consumeBits(chunk);
+            n -= chunk;
+        }
     }
 
     BitStream& operator<<(const BitStream &bits) {
-        BitStream *dup = bits.copy();
-        append(*dup);
-        delete dup;
+        bits.appendTo(*this);
         return *this;
     }
 
@@ -4,15 +4,21 @@
  * @see "Seattle University, CPSC2430, Spring 2018"
  */
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <stdexcept>
 #include "BitStreamF.h"
 using namespace std;
 
-BitStreamF::BitStreamF() : data() {
+static const size_t WORD_BITS = 64;
+static const size_t FILE_WORD_BYTES = sizeof(uint32_t);
+
+BitStreamF::BitStreamF() : words(), head(0), tail(0) {
 }
 
 bool BitStreamF::empty() const {
-    return data.empty();
+    return head == tail;
 }
 
 bool BitStreamF::full() const {
@@ -20,70 +26,192 @@ bool BitStreamF::full() const {
 }
 
 /*
- * Use the front to dequeue
+ * Use the head cursor to dequeue
  */
 bool BitStreamF::dequeue() {
     if (empty())
         return false;
-    Bits &front = data.front();
-    bool bit = front.dequeue();
-    if (front.empty())
-        data.pop_front();
+    bool bit = (words[head / WORD_BITS] >> (head % WORD_BITS)) & 1u;
+    advance(1);
     return bit;
 }
 
 /*
- * Use the back to enqueue
+ * Use the tail cursor to enqueue
  */
 void BitStreamF::enqueue(bool bit) {
-    if (data.empty() || data.back().full())
-        data.emplace_back();
-    data.back().enqueue(bit);
+    if (tail / WORD_BITS == words.size())
+        words.push_back(0);
+    if (bit)
+        words[tail / WORD_BITS] |= uint64_t(1) << (tail % WORD_BITS);
+    tail++;
+}
+
+void BitStreamF::advance(size_t n) {
+    head += n;
+    if (empty()) {
+        // start over at the front so the array doesn't creep forward
+        words.clear();
+        head = tail = 0;
+    } else if (head / WORD_BITS > words.size() / 2) {
+        compact();
+    }
+}
+
+uint64_t BitStreamF::bitsAt(size_t pos) const {
+    size_t i = pos / WORD_BITS, shift = pos % WORD_BITS;
+    if (i >= words.size())
+        return 0;
+    uint64_t w = words[i] >> shift;
+    if (shift != 0 && i + 1 < words.size())
+        w |= words[i + 1] << (WORD_BITS - shift);
+    return w;
+}
+
+void BitStreamF::putBits(uint64_t value, int n) {
+    if (n == 0)
+        return;
+    if (n < (int)WORD_BITS)
+        value &= (uint64_t(1) << n) - 1;
+    size_t i = tail / WORD_BITS, shift = tail % WORD_BITS;
+    words.resize((tail + n + WORD_BITS - 1) / WORD_BITS, 0);
+    words[i] |= value << shift;
+    if (shift + n > WORD_BITS)
+        words[i + 1] |= value >> (WORD_BITS - shift);
+    tail += n;
+}
+
+uint64_t BitStreamF::peekBits(int n) const {
+    uint64_t value = bitsAt(head);
+    if (n < (int)WORD_BITS)
+        value &= (uint64_t(1) << n) - 1;
+    return value;
+}
+
+uint64_t BitStreamF::peekBitsAt(size_t pos, int n) const {
+    uint64_t value = pos < size() ? bitsAt(head + pos) : 0;
+    if (n < (int)WORD_BITS)
+        value &= (uint64_t(1) << n) - 1;
+    return value;
+}
+
+void BitStreamF::consumeBits(int n) {
+    if ((size_t)n > size())
+        throw out_of_range("cannot consume past the end of a bit stream");
+    if (n > 0)
+        advance(n);
+}
+
+void BitStreamF::appendTo(BitStream& out) const {
+    size_t end = tail;  // fixed up front in case out is this stream
+    for (size_t pos = head; pos < end; pos += WORD_BITS)
+        out.putBits(bitsAt(pos), (int)min(WORD_BITS, end - pos));
+}
+
+void BitStreamF::compact() {
+    size_t drop = head / WORD_BITS;
+    words.erase(words.begin(), words.begin() + drop);
+    head -= drop * WORD_BITS;
+    tail -= drop * WORD_BITS;
 }
 
 BitStreamF* BitStreamF::copy() const {
     return new BitStreamF(*this);
 }
 
+BitStreamF::BitStreamF(const char *bytes, size_t bitCount)
+        : words((bitCount + WORD_BITS - 1) / WORD_BITS), head(0), tail(bitCount) {
+    size_t n = (bitCount + 7) / 8;
+    for (size_t i = 0; i < n; i++)
+        words[i / 8] |= uint64_t((unsigned char)bytes[i]) << (8 * (i % 8));
+    // clear any bits past the end so later enqueues can just set theirs
+    if (tail % WORD_BITS != 0)
+        words.back() &= (uint64_t(1) << (tail % WORD_BITS)) - 1;
+}
+
+size_t BitStreamF::size() const {
+    return tail - head;
+}
+
+string BitStreamF::toBytes() const {
+    string bytes((size() + 7) / 8, '\0');
+    for (size_t i = 0; i < bytes.size(); i++)
+        bytes[i] = (char)bitsAt(head + 8 * i);
+    if (size() % 8 != 0)
+        bytes.back() &= (char)((1u << (size() % 8)) - 1);
+    return bytes;
+}
+
+/*
+ * File layout (unchanged from the list-of-Bits version): the number of bits used in the first
+ * and in the last 32-bit word, then all the 32-bit words in native byte order.
+ */
 void BitStreamF::writeToFile(string filename) const {
     ofstream f;
     f.open(filename, ios::binary | ios::out);
     if (!f.is_open())
         throw invalid_argument(string("cannot open file ") + filename + " to write bit stream");
 
-    // first write out the number of bits in the first and last bytes
-    char len = static_cast<char>(data.front().bitsUsed());
-    f.write(&len, 1);
-    len = static_cast<char>(data.back().bitsUsed());
-    f.write(&len, 1);
-
-    // then write out all the Bits
-    for (const auto& b: data) {
-        unsigned int n = b.asInteger();
-        f.write((char*)&n, sizeof(n));
+    size_t bits = size();
+    size_t fileWords = bits == 0 ? 1 : (bits + 31) / 32;
+    char lengths[2];
+    lengths[0] = static_cast<char>(fileWords == 1 ? bits : 32);
+    lengths[1] = static_cast<char>(bits - 32 * (fileWords - 1));
+    f.write(lengths, sizeof(lengths));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (head == 0 && !words.empty()) {
+        // already aligned: the words are the file's 32-bit words back to back
+        f.write((const char *)words.data(), fileWords * FILE_WORD_BYTES);
+        return;
     }
+#endif
+    string bytes = toBytes();
+    vector<uint32_t> out(fileWords, 0);
+    for (size_t i = 0; i < bytes.size(); i++)
+        out[i / 4] |= uint32_t((unsigned char)bytes[i]) << (8 * (i % 4));
+    f.write((const char *)out.data(), fileWords * FILE_WORD_BYTES);
 }
 
-BitStreamF::BitStreamF(std::string filename) {
+BitStreamF::BitStreamF(std::string filename) : words(), head(0), tail(0) {
     ifstream f;
     f.open(filename, ios::binary | ios::in);
     if (!f.is_open())
         throw invalid_argument(string("cannot open file ") + filename + " to read bit stream");
 
-    char firstLength, lastLength;
-    f.read(&firstLength, 1);
-    f.read(&lastLength, 1);
-
-    // first Bits of correct length
-    unsigned int datum;
-    f.read((char*)&datum, sizeof(datum));
-    data.emplace_back(datum, firstLength);
-
-    // middle Bits (including last one which we will overwrite with the correct size after exiting loop)
-    while (!f.eof() && f.read((char*)&datum, sizeof(datum)))
-        data.emplace_back(datum);
-
-    // replace final one with a Bits of correct length
-    data.back() = Bits(datum, lastLength);
+    f.seekg(0, ios::end);
+    streamoff fileSize = f.tellg();
+    f.seekg(0, ios::beg);
+    char lengths[2];
+    if (fileSize < (streamoff)(sizeof(lengths) + FILE_WORD_BYTES) || !f.read(lengths, sizeof(lengths)))
+        throw invalid_argument(string("file ") + filename + " is not a bit stream");
+    size_t firstLength = (unsigned char)lengths[0];
+    size_t lastLength = (unsigned char)lengths[1];
+    size_t fileWords = (fileSize - sizeof(lengths)) / FILE_WORD_BYTES;
+    if (firstLength > 32 || lastLength > 32)
+        throw invalid_argument(string("file ") + filename + " is not a bit stream");
+
+    vector<uint32_t> in(fileWords + 1, 0);  // one spare so pairs of words always fill a uint64_t
+    if (!f.read((char *)in.data(), fileWords * FILE_WORD_BYTES))
+        throw invalid_argument(string("file ") + filename + " ended early");
+    words.resize((fileWords + 1) / 2);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(words.data(), in.data(), words.size() * sizeof(uint64_t));
+#else
+    for (size_t i = 0; i < words.size(); i++)
+        words[i] = in[2 * i] | (uint64_t(in[2 * i + 1]) << 32);
+#endif
+
+    if (fileWords == 1) {
+        tail = lastLength;
+    } else {
+        // a partly dequeued first word keeps its remaining bits at the bottom, so slide them
+        // up against the second word and start reading part way in
+        head = 32 - firstLength;
+        uint64_t first = (words[0] << head) & 0xffffffffu;
+        words[0] = (words[0] & ~uint64_t(0xffffffffu)) | first;
+        tail = 32 * (fileWords - 1) + lastLength;
+    }
+    if (tail % WORD_BITS != 0)
+        words.back() &= (uint64_t(1) << (tail % WORD_BITS)) - 1;
 }
-
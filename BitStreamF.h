@@ -6,10 +6,11 @@
 
 #pragma once
 
-#include <list>
+#include <cstdint>
+#include <string>
+#include <vector>
 #include "adt/BitStream.h"
 #include "Bits.h"
-#include "ListA.h"
 
 /**
  * @class BitStreamF - Implementation of BitStream destined for a binary file.
@@ -18,8 +19,12 @@
  * May be written to a file with writeToFile() method.
  * May be written to an ostream via << operator, in which case you get the bits
  * as ASCII '0's and '1's.
+ *
+ * The bits are kept in one growable array of 64-bit words (first bit in the low-order
+ * bit of the first word) with a read cursor and a write cursor, so saving and loading
+ * are each a single bulk write or read.
  */
-class BitStreamF : public BitStream {
+class BitStreamF final : public BitStream {
 public:
     /**
      * Construct an empty bit stream, suitable for receiving bits via enqueue.
@@ -35,6 +40,14 @@ public:
      */
     BitStreamF(std::string filename);
 
+    /**
+     * Load a bit stream from a packed byte buffer (as produced by toBytes()).
+     * @param bytes     packed bits, first bit in the low-order bit of bytes[0]
+     * @param bitCount  number of bits to take from bytes
+     * @pre             bytes has at least (bitCount+7)/8 bytes
+     */
+    BitStreamF(const char *bytes, size_t bitCount);
+
     // implement BitStream ADT
     bool empty() const;
     bool full() const;
@@ -42,6 +55,26 @@ public:
     void enqueue(bool bit);
     BitStreamF *copy() const;
 
+    // whole-word versions of the BitStream multi-bit operations
+    size_t size() const;
+    void putBits(uint64_t value, int n);
+    uint64_t peekBits(int n) const;
+    void consumeBits(int n);
+    void appendTo(BitStream& out) const;
+
+    /**
+     * Look at n bits starting pos bits past the front of the stream, without dequeueing anything.
+     * @param pos  offset from the next bit to be dequeued
+     * @param n    number of bits, 0..64; bits past the end of the stream are zeros
+     */
+    uint64_t peekBitsAt(size_t pos, int n) const;
+
+    /**
+     * Pack the bits into bytes, first bit in the low-order bit of the first byte.
+     * @return  (size()+7)/8 bytes, the unused high bits of the last byte are zeros
+     */
+    std::string toBytes() const;
+
     /**
      * Write the bits out to the given file.
      *
@@ -52,7 +85,24 @@ public:
      */
     void writeToFile(std::string filename) const;
 private:
-    std::list<Bits> data;
+    std::vector<uint64_t> words;
+    size_t head;  // index of the next bit to dequeue
+    size_t tail;  // index one past the last bit enqueued
+
+    /**
+     * Drop the words that have been completely dequeued once they are half the array.
+     */
+    void compact();
+
+    /**
+     * The 64 bits starting at bit index pos (zeros past the last word).
+     */
+    uint64_t bitsAt(size_t pos) const;
+
+    /**
+     * Move the read cursor forward after a dequeue.
+     */
+    void advance(size_t n);
 };
 
 
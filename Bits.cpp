@@ -46,6 +46,38 @@ Bits *Bits::copy() const {
     return new Bits(*this);
 }
 
+size_t Bits::size() const {
+    return length;
+}
+
+void Bits::putBits(uint64_t value, int n) {
+    if (n > MAX_BITS - length)
+        throw overflow_error("Bits full");
+    if (n == 0)
+        return;
+    uint64_t mask = (uint64_t(1) << n) - 1;
+    uint64_t kept = integer & ((uint64_t(1) << length) - 1);  // bits past length should be zeros already, but just in case...
+    integer = (unsigned int)(kept | ((value & mask) << length));
+    length += n;
+}
+
+uint64_t Bits::peekBits(int n) const {
+    if (n > length)
+        n = length;
+    return integer & ((uint64_t(1) << n) - 1);
+}
+
+void Bits::consumeBits(int n) {
+    if (n > length)
+        throw out_of_range("cannot consume past the end of a Bits");
+    integer = (unsigned int)((uint64_t)integer >> n);
+    length -= n;
+}
+
+void Bits::appendTo(BitStream& out) const {
+    out.putBits(peekBits(length), length);
+}
+
 unsigned int Bits::asInteger() const {
     return integer;
 }
@@ -13,7 +13,7 @@
 /**
  * @class Bits - get and set bits from an integer
  */
-class Bits : public BitStream {
+class Bits final : public BitStream {
 public:
     static const int MAX_BITS = sizeof(unsigned int) * 8;
     Bits();
@@ -27,6 +27,13 @@ public:
     bool full() const;
     Bits *copy() const;
 
+    // whole-word versions of the BitStream multi-bit operations
+    size_t size() const;
+    void putBits(uint64_t value, int n);
+    uint64_t peekBits(int n) const;
+    void consumeBits(int n);
+    void appendTo(BitStream& out) const;
+
     unsigned int asInteger() const;
     int bitsUsed() const;
 
@@ -0,0 +1,242 @@
+/**
+ * @file BlockCodec.cpp - Frames of Huffman codes for block-at-a-time streaming.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include "BlockCodec.h"
+#include "Crc32c.h"
+using namespace std;
+
+BlockCodec::BlockCodec(const Huffman& model, double minSavings, size_t sampleSize, bool checksums, Coder coder)
+        : models(1, &model), minSavings(minSavings), sampleSize(sampleSize), checksums(checksums), coder(coder) {
+    buildTans();
+}
+
+BlockCodec::BlockCodec(const ModelSet& models, double minSavings, size_t sampleSize, bool checksums, Coder coder)
+        : models(), minSavings(minSavings), sampleSize(sampleSize), checksums(checksums), coder(coder) {
+    if (models.size() == 0 || models.size() > UINT16_MAX + 1)
+        throw invalid_argument("a model set for frames needs 1 to 65536 models");
+    for (size_t i = 0; i < models.size(); i++)
+        this->models.push_back(&models.get(i));
+    buildTans();
+}
+
+void BlockCodec::buildTans() {
+    tans.resize(models.size());
+    if (coder == USE_HUFFMAN)
+        return;
+    // every block is predicted against every model's tables, so there is no point waiting
+    for (size_t m = 0; m < models.size(); m++) {
+        tans[m] = make_shared<const TansCoder>(*models[m]);
+        tables.push_back(tans[m].get());
+    }
+}
+
+shared_ptr<const TansCoder> BlockCodec::tansFor(size_t model) const {
+    lock_guard<mutex> lock(tansLock);
+    if (!tans[model])
+        tans[model] = make_shared<const TansCoder>(*models[model]);
+    return tans[model];
+}
+
+shared_ptr<const TansCoder> BlockCodec::tansFor(const Huffman& model) const {
+    uint64_t frequencies[Huffman::MAX_CHAR+1];
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        frequencies[c] = model.getFrequency((unsigned char)c);
+    {
+        lock_guard<mutex> lock(tansLock);
+        if (lastTans && memcmp(frequencies, lastFrequencies, sizeof(frequencies)) == 0)
+            return lastTans;
+    }
+    // built outside the lock, so other threads' hits need not wait for it
+    shared_ptr<const TansCoder> built = make_shared<const TansCoder>(frequencies);
+    lock_guard<mutex> lock(tansLock);
+    lastTans = built;
+    memcpy(lastFrequencies, frequencies, sizeof(frequencies));
+    return built;
+}
+
+void BlockCodec::encode(const string& raw, string& frame) const {
+    encode(raw, frame, models.data(), tables.empty() ? nullptr : tables.data(), models.size());
+}
+
+void BlockCodec::encode(const string& raw, string& frame, const Huffman& model) const {
+    const Huffman *only = &model;
+    if (coder == USE_HUFFMAN) {
+        encode(raw, frame, &only, nullptr, 1);
+        return;
+    }
+    shared_ptr<const TansCoder> table = tansFor(model);
+    const TansCoder *onlyTable = table.get();
+    encode(raw, frame, &only, &onlyTable, 1);
+}
+
+void BlockCodec::encode(const string& raw, string& frame, const Huffman *const *candidates,
+                        const TansCoder *const *tables, size_t count) const {
+    FrameHeader header = {};
+    header.rawLength = (uint32_t)raw.size();
+    header.flags = checksums ? CHECKSUM : 0;
+    if (!encodeCoded(raw, frame, header, candidates, tables, count)) {
+        header.type = STORED;
+        header.payloadBits = (uint32_t)(8 * raw.size());
+        frame.resize(prefixSize(header));
+        frame += raw;
+    }
+    memcpy(&frame[0], &header, HEADER_SIZE);
+    if (checksums) {
+        uint32_t crc = Crc32c::compute((const uint8_t *)raw.data(), raw.size());
+        memcpy(&frame[HEADER_SIZE], &crc, CHECKSUM_SIZE);
+    }
+}
+
+bool BlockCodec::encodeCoded(const string& raw, string& frame, FrameHeader& header,
+                             const Huffman *const *candidates, const TansCoder *const *tables, size_t count) const {
+    const uint8_t *text = (const uint8_t *)raw.data();
+    uint64_t histogram[Huffman::MAX_CHAR+1];
+    uint64_t counted = CompressibilityProbe::histogram(text, raw.size(), sampleSize, histogram);
+    size_t best = 0;
+    FrameType bestType = HUFFMAN;
+    uint64_t predicted = UINT64_MAX;
+    for (size_t m = 0; m < count; m++) {
+        if (coder != USE_ANS || tables == nullptr) {
+            uint64_t bits = CompressibilityProbe::huffmanBits(histogram, *candidates[m]);
+            if (bits < predicted) {
+                best = m;
+                bestType = HUFFMAN;
+                predicted = bits;
+            }
+        }
+        if (coder != USE_HUFFMAN && tables != nullptr) {
+            uint64_t bits = tables[m]->predictBits(histogram);
+            if (bits < predicted) {
+                best = m;
+                bestType = ANS;
+                predicted = bits;
+            }
+        }
+    }
+    if (predicted == UINT64_MAX || CompressibilityProbe::savings(predicted, counted) < minSavings)
+        return false;
+    HuffmanCoder huffman(*candidates[best]);
+    const EntropyCoder& entropy = bestType == ANS ? (const EntropyCoder&)*tables[best] : huffman;
+
+    size_t prefix = prefixSize(header);
+    frame.resize(prefix + entropy.encodedBound(raw.size()));
+    size_t bits;
+    try {
+        bits = entropy.encode(text, raw.size(), (uint8_t *)&frame[prefix], frame.size() - prefix);
+    } catch (const invalid_argument&) {
+        return false;  // a character the sample missed and the model can't code
+    }
+    if (bits >= 8 * raw.size())
+        return false;
+    header.type = bestType;
+    header.model = (uint16_t)best;
+    header.payloadBits = (uint32_t)bits;
+    frame.resize(prefix + (bits + 7) / 8);
+    return true;
+}
+
+void BlockCodec::decode(const string& frame, string& raw) const {
+    decode(frame, raw, nullptr);
+}
+
+void BlockCodec::decode(const string& frame, string& raw, const Huffman& model) const {
+    decode(frame, raw, &model);
+}
+
+void BlockCodec::decode(const string& frame, string& raw, const Huffman *model) const {
+    if (frame.size() < HEADER_SIZE)
+        throw invalid_argument("frame too short");
+    FrameHeader header;
+    memcpy(&header, frame.data(), HEADER_SIZE);
+    size_t prefix = prefixSize(header);
+    if (frame.size() != prefix + ((size_t)header.payloadBits + 7) / 8)
+        throw invalid_argument("frame size does not match its header");
+    const uint8_t *payload = (const uint8_t *)frame.data() + prefix;
+    switch (header.type) {
+    case STORED:
+        if (header.payloadBits != 8 * (uint64_t)header.rawLength)
+            throw invalid_argument("stored frame size does not match its length");
+        raw.assign((const char *)payload, header.rawLength);
+        break;
+    case HUFFMAN:
+    case ANS: {
+        if (header.model >= (model != nullptr ? 1 : models.size()))
+            throw invalid_argument("frame coded with unknown model " + to_string(header.model));
+        HuffmanCoder huffman(model != nullptr ? *model : *models[header.model]);
+        shared_ptr<const TansCoder> table;  // keeps the tables alive while decoding
+        const EntropyCoder *entropy = &huffman;
+        if (header.type == ANS) {
+            table = model != nullptr ? tansFor(*model) : tansFor(header.model);
+            entropy = table.get();
+        }
+        raw.resize(header.rawLength);
+        try {
+            entropy->decode(payload, header.payloadBits, (uint8_t *)&raw[0], raw.size());
+        } catch (const invalid_argument&) {
+            throw invalid_argument("frame codes do not match its length");
+        }
+        break;
+    }
+    case MODEL:
+        throw invalid_argument("model frame where a block was expected");
+    default:
+        throw invalid_argument("unknown frame type " + to_string(header.type));
+    }
+    if (header.flags & CHECKSUM) {
+        uint32_t expected;
+        memcpy(&expected, frame.data() + HEADER_SIZE, CHECKSUM_SIZE);
+        if (Crc32c::compute((const uint8_t *)raw.data(), raw.size()) != expected)
+            throw invalid_argument("text does not match the frame checksum");
+    }
+}
+
+bool BlockCodec::readFrame(istream& in, string& frame) {
+    FrameHeader header;
+    if (!in.read((char *)&header.rawLength, sizeof(header.rawLength)))
+        throw invalid_argument("frame stream ended early");
+    if (header.rawLength == 0)
+        return false;
+    if (!in.read((char *)&header + sizeof(header.rawLength), HEADER_SIZE - sizeof(header.rawLength)))
+        throw invalid_argument("frame stream ended early");
+    frame.resize(prefixSize(header) + ((size_t)header.payloadBits + 7) / 8);
+    memcpy(&frame[0], &header, HEADER_SIZE);
+    if (!in.read(&frame[HEADER_SIZE], frame.size() - HEADER_SIZE))
+        throw invalid_argument("frame stream ended early");
+    return true;
+}
+
+void BlockCodec::encodeModel(const Huffman& model, string& frame) {
+    ostringstream table;
+    model.writeFrequencies(table);
+    FrameHeader header = {};
+    header.type = MODEL;
+    header.rawLength = (uint32_t)table.str().size();
+    header.payloadBits = 8 * header.rawLength;
+    frame.assign((const char *)&header, HEADER_SIZE);
+    frame += table.str();
+}
+
+bool BlockCodec::decodeModel(const string& frame, uint64_t frequencies[]) {
+    FrameHeader header;
+    if (frame.size() < HEADER_SIZE)
+        throw invalid_argument("frame too short");
+    memcpy(&header, frame.data(), HEADER_SIZE);
+    if (header.type != MODEL)
+        return false;
+    if (header.flags != 0 || frame.size() != HEADER_SIZE + (Huffman::MAX_CHAR+1) * sizeof(uint64_t))
+        throw invalid_argument("model frame is malformed");
+    istringstream table(frame.substr(HEADER_SIZE));
+    Huffman::readFrequencies(table, frequencies);
+    return true;
+}
+
+void BlockCodec::writeEnd(ostream& out) {
+    uint32_t end = 0;
+    out.write((const char *)&end, sizeof(end));
+}
@@ -0,0 +1,262 @@
+/**
+ * @file BlockCodec.h - Frames of Huffman codes for block-at-a-time streaming.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "Huffman.h"
+#include "CompressibilityProbe.h"
+#include "EntropyCoder.h"
+#include "ModelSet.h"
+#include "TansCoder.h"
+
+/**
+ * @class BlockCodec - codes one block of text into one self-delimiting frame and back.
+ *
+ * Frames are coded against either one Huffman model or a trained ModelSet, neither of
+ * which is stored in the frames (just like p2.cpp, the decoder must be given equivalent
+ * models). With a ModelSet, each block is coded with whichever model the probe predicts
+ * codes it smallest, and the model's number is recorded in the frame header.
+ *
+ * Each model can code a block with its Huffman codes or with a TansCoder built from the
+ * same frequencies (better for very skewed text, but slower), as chosen by the Coder
+ * given to the constructor; USE_BEST picks whichever predicts the smaller frame for each
+ * block. Any codec decodes frames of either kind.
+ *
+ * Before coding, a CompressibilityProbe of the block predicts the coded size. If coding
+ * would save less than minSavings (already-compressed or encrypted data, or characters
+ * the model cannot code) the block is stored as-is instead, so no CPU is spent on it and
+ * the frame is never much bigger than the text.
+ *
+ * Optionally each frame also carries the CRC-32C of its text, which decode() checks
+ * after decoding (while the text is still in cache) so that a corrupt frame is reported
+ * instead of silently decoding to garbage.
+ *
+ * Frame layout:
+ *     FrameHeader, [uint32 CRC-32C of the text if flags has CHECKSUM],
+ *     (payloadBits+7)/8 bytes of payload
+ * A stream of frames is ended by a lone rawLength of zero (see writeEnd()).
+ *
+ * The tANS tables a codec needs only for decoding are built the first time an ANS frame
+ * names their model, and kept. That cache is behind a lock, so one object may still be
+ * used from several threads.
+ */
+class BlockCodec {
+public:
+    static constexpr double DEFAULT_MIN_SAVINGS = 0.02;
+
+    /**
+     * Which entropy coders encode() may use.
+     */
+    enum Coder : uint8_t {
+        USE_HUFFMAN = 0,  // Huffman codes only (the fastest)
+        USE_ANS = 1,      // tANS only
+        USE_BEST = 2      // whichever predicts the smaller frame, block by block
+    };
+
+    /**
+     * @param model       the Huffman codes for every block, must outlive this object
+     * @param minSavings  store blocks that coding would shrink by less than this fraction
+     * @param sampleSize  characters of each block the probe looks at (0 for all of them)
+     * @param checksums   whether to add a CRC-32C of the text to each frame
+     * @param coder       which entropy coders to code blocks with
+     */
+    explicit BlockCodec(const Huffman& model, double minSavings = DEFAULT_MIN_SAVINGS,
+                        size_t sampleSize = CompressibilityProbe::DEFAULT_SAMPLE_SIZE,
+                        bool checksums = false, Coder coder = USE_HUFFMAN);
+
+    /**
+     * @param models      the models to choose from for each block, must outlive this object
+     * @param minSavings  store blocks that coding would shrink by less than this fraction
+     * @param sampleSize  characters of each block the probe looks at (0 for all of them)
+     * @param checksums   whether to add a CRC-32C of the text to each frame
+     * @param coder       which entropy coders to code blocks with
+     */
+    explicit BlockCodec(const ModelSet& models, double minSavings = DEFAULT_MIN_SAVINGS,
+                        size_t sampleSize = CompressibilityProbe::DEFAULT_SAMPLE_SIZE,
+                        bool checksums = false, Coder coder = USE_HUFFMAN);
+
+    // big 5 (holds a lock, so neither copying nor moving is allowed)
+    ~BlockCodec() = default;
+    BlockCodec(const BlockCodec& other) = delete;
+    BlockCodec(BlockCodec&& temp) = delete;
+    BlockCodec& operator=(const BlockCodec& other) = delete;
+    BlockCodec& operator=(BlockCodec&& temp) = delete;
+
+    /**
+     * Code one block of text into a frame.
+     *
+     * @param raw    text of the block, must not be empty
+     * @param frame  receives the whole frame, header included
+     */
+    void encode(const std::string& raw, std::string& frame) const;
+
+    /**
+     * Code one block of text into a frame with the given model instead of this codec's
+     * own (which are then only used for decoding frames that name them). The frame says
+     * model 0, so decode it with decode(frame, raw, model) and an equivalent model. The
+     * tANS tables for the last such model are kept, so a run of blocks coded with one model
+     * builds them once.
+     */
+    void encode(const std::string& raw, std::string& frame, const Huffman& model) const;
+
+    /**
+     * Decode a frame produced by encode() (or read by readFrame()).
+     *
+     * @param frame  the whole frame, header included
+     * @param raw    receives the text of the block
+     * @throws invalid_argument  if the frame is malformed, the codes don't match its length,
+     *                           or the text doesn't match the frame's checksum
+     */
+    void decode(const std::string& frame, std::string& raw) const;
+
+    /**
+     * Decode a frame produced by encode(raw, frame, model). As with encoding, the tANS
+     * tables for the last model are kept.
+     */
+    void decode(const std::string& frame, std::string& raw, const Huffman& model) const;
+
+    /**
+     * Make a MODEL frame that carries the frequency table of a model, so a decoder can build
+     * the same codes for the frames that follow it (see AdaptiveModel and Pipeline).
+     */
+    static void encodeModel(const Huffman& model, std::string& frame);
+
+    /**
+     * If frame is a MODEL frame, get the frequency table it carries.
+     *
+     * @return  false if frame is not a MODEL frame
+     * @throws invalid_argument  if it is one but is malformed
+     */
+    static bool decodeModel(const std::string& frame, uint64_t frequencies[]);
+
+    /**
+     * Read the next frame from a stream of frames.
+     *
+     * @param in     binary stream of frames
+     * @param frame  receives the whole frame, header included
+     * @return       false once the end marker is read
+     * @throws invalid_argument  if the stream ends before the end marker
+     */
+    static bool readFrame(std::istream& in, std::string& frame);
+
+    /**
+     * Write the end marker after the last frame.
+     */
+    static void writeEnd(std::ostream& out);
+
+    /**
+     * How the payload of a frame is coded.
+     */
+    enum FrameType : uint8_t {
+        HUFFMAN = 0,  // Huffman codes from one of the models
+        STORED = 1,   // the text itself
+        MODEL = 2,    // a frequency table (see encodeModel()) instead of text
+        ANS = 3       // tANS codes from one of the models' frequencies
+    };
+
+    /**
+     * Bits of FrameHeader::flags.
+     */
+    enum FrameFlags : uint8_t {
+        CHECKSUM = 1  // a CRC-32C of the text follows the header
+    };
+
+    struct FrameHeader {
+        uint32_t rawLength;    // characters of text in the frame (never 0)
+        uint32_t payloadBits;  // bits of payload after the header and checksum
+        uint8_t type;          // a FrameType
+        uint8_t flags;         // FrameFlags
+        uint16_t model;        // which model coded a HUFFMAN or ANS frame
+    };
+
+    static const size_t HEADER_SIZE = sizeof(FrameHeader);
+    static const size_t CHECKSUM_SIZE = sizeof(uint32_t);
+
+private:
+    std::vector<const Huffman *> models;
+    std::vector<const TansCoder *> tables;  // tans, as plain pointers, unless USE_HUFFMAN
+    double minSavings;
+    size_t sampleSize;
+    bool checksums;
+    Coder coder;
+
+    mutable std::mutex tansLock;                                 // guards the members below
+    mutable std::vector<std::shared_ptr<const TansCoder>> tans;  // of each model, once needed
+    mutable std::shared_ptr<const TansCoder> lastTans;           // of the last outside model
+    mutable uint64_t lastFrequencies[Huffman::MAX_CHAR+1];       // which lastTans was built from
+
+    /**
+     * Bytes of header and checksum before the payload.
+     */
+    static size_t prefixSize(const FrameHeader& header) {
+        return HEADER_SIZE + ((header.flags & CHECKSUM) ? CHECKSUM_SIZE : 0);
+    }
+
+    /**
+     * Build the tANS tables for models, if the coder uses them.
+     */
+    void buildTans();
+
+    /**
+     * The tANS tables of one of models, built on first use.
+     */
+    std::shared_ptr<const TansCoder> tansFor(size_t model) const;
+
+    /**
+     * The tANS tables of a model from outside, reusing the last ones if it has the same
+     * frequencies as the last.
+     */
+    std::shared_ptr<const TansCoder> tansFor(const Huffman& model) const;
+
+    /**
+     * Probe the block and code it with whichever allowed coder of which model predicts the
+     * smallest payload.
+     * @return  false if the block should be stored instead
+     */
+    bool encodeCoded(const std::string& raw, std::string& frame, FrameHeader& header,
+                     const Huffman *const *candidates, const TansCoder *const *tables, size_t count) const;
+
+    /**
+     * encode() with the given models in place of this->models. tables holds the models'
+     * tANS coders (null for none, to use Huffman codes only).
+     */
+    void encode(const std::string& raw, std::string& frame, const Huffman *const *candidates,
+                const TansCoder *const *tables, size_t count) const;
+
+    /**
+     * decode() with the given model in place of this->models (null for this->models).
+     */
+    void decode(const std::string& frame, std::string& raw, const Huffman *model) const;
+};
+
+/**
+ * @class CorruptFrame - a frame in a stream of frames failed to decode.
+ */
+class CorruptFrame : public std::invalid_argument {
+public:
+    /**
+     * @param frame  number of the bad frame, counting from 0
+     * @param why    what was wrong with it
+     */
+    CorruptFrame(uint64_t frame, const std::string& why)
+            : std::invalid_argument("frame " + std::to_string(frame) + " is corrupt: " + why), number(frame) {}
+
+    /**
+     * Number of the bad frame, counting from 0.
+     */
+    uint64_t frame() const {
+        return number;
+    }
+
+private:
+    uint64_t number;
+};
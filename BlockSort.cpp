@@ -0,0 +1,383 @@
+/**
+ * @file BlockSort.cpp - Block-sorting (BWT + move-to-front + zero-run) high-ratio mode.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "BlockSort.h"
+#include "Huffman.h"
+using namespace std;
+
+namespace {
+
+/*
+ * Run work(i) for i in 0..n-1 spread over up to threads threads. The first exception
+ * thrown by any worker is rethrown here once all of them are done.
+ */
+template <typename Work>
+void parallelFor(size_t n, int threads, Work work) {
+    size_t workers = min((size_t)max(threads, 1), n);
+    if (workers <= 1) {
+        for (size_t i = 0; i < n; i++)
+            work(i);
+        return;
+    }
+    vector<exception_ptr> errors(workers);
+    vector<thread> pool;
+    for (size_t w = 0; w < workers; w++)
+        pool.emplace_back([&, w]() {
+            try {
+                for (size_t i = w; i < n; i += workers)
+                    work(i);
+            } catch (...) {
+                errors[w] = current_exception();
+            }
+        });
+    for (auto& t: pool)
+        t.join();
+    for (auto& e: errors)
+        if (e)
+            rethrow_exception(e);
+}
+
+void writeWord(ostream& out, uint32_t n) {
+    out.write((const char *)&n, sizeof(n));
+}
+
+uint32_t readWord(istream& in) {
+    uint32_t n;
+    if (!in.read((char *)&n, sizeof(n)))
+        throw invalid_argument("block sort stream ended early");
+    return n;
+}
+
+/*
+ * Counts are written 7 bits per byte, low-order group first, as MessageBatch lengths are.
+ */
+void writeVarint(ostream& out, uint64_t n) {
+    for (; n >= 0x80; n >>= 7)
+        out.put((char)(uint8_t)(n | 0x80));
+    out.put((char)(uint8_t)n);
+}
+
+uint64_t readVarint(istream& in) {
+    uint64_t n = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int b = in.get();
+        if (b == EOF)
+            throw invalid_argument("block sort stream ended early");
+        n |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return n;
+    }
+    throw invalid_argument("block sort count is too long");
+}
+
+// primary of a block kept as it is (a transformed block's primary is at least 1)
+const uint32_t STORED = 0;
+
+const int PRESENT_BYTES = (Huffman::MAX_CHAR + 1) / 8;
+
+/*
+ * The counts of the characters in a block of runs: a bitmap of which characters are
+ * there, then each one's count.
+ */
+void writeCounts(ostream& out, const uint64_t frequencies[]) {
+    uint8_t present[PRESENT_BYTES] = {};
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        if (frequencies[c] != 0)
+            present[c / 8] |= (uint8_t)(1 << (c % 8));
+    out.write((const char *)present, sizeof(present));
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        if (frequencies[c] != 0)
+            writeVarint(out, frequencies[c]);
+}
+
+void readCounts(istream& in, uint64_t frequencies[]) {
+    uint8_t present[PRESENT_BYTES];
+    if (!in.read((char *)present, sizeof(present)))
+        throw invalid_argument("block sort stream ended early");
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++) {
+        frequencies[c] = 0;
+        if (present[c / 8] & (1 << (c % 8))) {
+            frequencies[c] = readVarint(in);
+            if (frequencies[c] == 0)
+                throw invalid_argument("block sort count of a present character is zero");
+        }
+    }
+}
+
+}
+
+BlockSort::BlockSort(size_t blockSize, int threads) : blockSize(blockSize), threads(threads) {
+    if (blockSize == 0)
+        throw invalid_argument("block size must be positive");
+}
+
+void BlockSort::compress(istream& in, ostream& out) const {
+    vector<string> blocks(max(threads, 1));
+    vector<string> records(blocks.size());
+    for (;;) {
+        // read one batch of blocks, one per thread
+        size_t count = 0;
+        while (count < blocks.size()) {
+            blocks[count].resize(blockSize);
+            in.read(&blocks[count][0], blockSize);
+            blocks[count].resize(in.gcount());
+            if (blocks[count].empty())
+                break;
+            count++;
+        }
+        parallelFor(count, threads, [&](size_t i) { records[i] = encodeBlock(blocks[i]); });
+        for (size_t i = 0; i < count; i++)
+            out << records[i];
+        if (count < blocks.size())
+            break;
+    }
+    writeWord(out, 0);
+}
+
+void BlockSort::decompress(istream& in, ostream& out) const {
+    vector<string> records(max(threads, 1));
+    vector<string> blocks(records.size());
+    bool more = true;
+    while (more) {
+        size_t count = 0;
+        while (count < records.size() && (more = readRecord(in, records[count])))
+            count++;
+        parallelFor(count, threads, [&](size_t i) { blocks[i] = decodeBlock(records[i]); });
+        for (size_t i = 0; i < count; i++)
+            out << blocks[i];
+    }
+}
+
+string BlockSort::encodeBlock(const string& raw) {
+    uint32_t primary;
+    string runs = rleZeros(mtf(bwt(raw, primary)));
+
+    uint64_t frequencies[Huffman::MAX_CHAR+1] = {};
+    for (char c: runs)
+        frequencies[(unsigned char)c]++;
+    Huffman huffman(frequencies);
+    string coded(huffman.encodedBound(runs.size()), '\0');
+    size_t bitCount = huffman.encode((const uint8_t *)runs.data(), runs.size(),
+                                     (uint8_t *)&coded[0], coded.size());
+    coded.resize((bitCount + 7) / 8);
+
+    ostringstream record;
+    writeWord(record, (uint32_t)raw.size());
+    writeWord(record, primary);
+    writeWord(record, (uint32_t)runs.size());
+    writeCounts(record, frequencies);
+    writeWord(record, (uint32_t)bitCount);
+    record << coded;
+    if (record.tellp() < (streamoff)(2 * sizeof(uint32_t) + raw.size()))
+        return record.str();
+
+    // the transform did not pay for its counts: keep the block as it is
+    ostringstream stored;
+    writeWord(stored, (uint32_t)raw.size());
+    writeWord(stored, STORED);
+    stored << raw;
+    return stored.str();
+}
+
+/*
+ * The record is copied field by field, so its length is known without decoding it.
+ */
+bool BlockSort::readRecord(istream& in, string& record) {
+    uint32_t rawLength = readWord(in);
+    if (rawLength == 0)
+        return false;
+    uint32_t primary = readWord(in);
+    ostringstream header;
+    writeWord(header, rawLength);
+    writeWord(header, primary);
+    size_t rest = rawLength;
+    if (primary != STORED) {
+        writeWord(header, readWord(in));
+        uint64_t frequencies[Huffman::MAX_CHAR+1];
+        readCounts(in, frequencies);
+        writeCounts(header, frequencies);
+        uint32_t bitCount = readWord(in);
+        writeWord(header, bitCount);
+        rest = ((size_t)bitCount + 7) / 8;
+    }
+    record = header.str();
+    size_t start = record.size();
+    record.resize(start + rest);
+    if (!in.read(&record[start], rest))
+        throw invalid_argument("block sort stream ended early");
+    return true;
+}
+
+string BlockSort::decodeBlock(const string& record) {
+    istringstream in(record);
+    uint32_t rawLength = readWord(in);
+    uint32_t primary = readWord(in);
+    if (primary == STORED) {
+        if (record.size() != 2 * sizeof(uint32_t) + rawLength)
+            throw invalid_argument("block sort stored block does not match block length");
+        return record.substr(2 * sizeof(uint32_t));
+    }
+    uint32_t rleLength = readWord(in);
+    uint64_t frequencies[Huffman::MAX_CHAR+1];
+    readCounts(in, frequencies);
+    uint32_t bitCount = readWord(in);
+    const char *bytes = record.data() + record.size() - (bitCount + 7) / 8;
+
+    Huffman huffman(frequencies);
+    string runs(rleLength, '\0');
+    if (huffman.decode((const uint8_t *)bytes, bitCount, (uint8_t *)&runs[0], runs.size()) != rleLength)
+        throw invalid_argument("block sort codes do not match block length");
+    string raw = unbwt(unmtf(unrleZeros(runs)), primary);
+    if (raw.size() != rawLength)
+        throw invalid_argument("block sort transform does not match block length");
+    return raw;
+}
+
+/*
+ * Suffix array by prefix doubling: after the round with step k, suffixes are sorted by
+ * their first 2k characters. A suffix that runs off the end sorts before any that doesn't,
+ * which is exactly the implied end-of-block sentinel.
+ */
+string BlockSort::bwt(const string& block, uint32_t& primary) {
+    int n = (int)block.size();
+    primary = 0;
+    if (n == 0)
+        return string();
+    vector<int> sa(n), rank(n), next(n);
+    for (int i = 0; i < n; i++) {
+        sa[i] = i;
+        rank[i] = (unsigned char)block[i];
+    }
+    for (int k = 1; ; k *= 2) {
+        auto key = [&](int i) { return make_pair(rank[i], i + k < n ? rank[i + k] : -1); };
+        sort(sa.begin(), sa.end(), [&](int a, int b) { return key(a) < key(b); });
+        next[sa[0]] = 0;
+        for (int i = 1; i < n; i++)
+            next[sa[i]] = next[sa[i - 1]] + (key(sa[i - 1]) < key(sa[i]) ? 1 : 0);
+        rank.swap(next);
+        if (rank[sa[n - 1]] == n - 1)
+            break;
+    }
+
+    // row 0 is the sentinel suffix, whose preceding character is the last one in the block
+    string last;
+    last.reserve(n);
+    last += block[n - 1];
+    for (int i = 0; i < n; i++) {
+        if (sa[i] == 0)
+            primary = i + 1;
+        else
+            last += block[sa[i] - 1];
+    }
+    return last;
+}
+
+string BlockSort::unbwt(const string& last, uint32_t primary) {
+    size_t n = last.size();
+    if (n > 0 && (primary == 0 || primary > n))
+        throw invalid_argument("bad block sort primary index");
+
+    // first[c] is the first row starting with c; row 0 belongs to the sentinel
+    size_t first[Huffman::MAX_CHAR+2] = {};
+    for (char c: last)
+        first[(unsigned char)c + 1]++;
+    first[0] = 1;
+    for (int c = 1; c <= Huffman::MAX_CHAR+1; c++)
+        first[c] += first[c - 1];
+
+    // lf[row] is the row of the suffix one character earlier (sentinel row is skipped in last)
+    vector<uint32_t> lf(n + 1);
+    size_t seen[Huffman::MAX_CHAR+1] = {};
+    for (size_t row = 0, i = 0; row <= n; row++) {
+        if (row == primary) {
+            lf[row] = 0;
+            continue;
+        }
+        unsigned char c = (unsigned char)last[i++];
+        lf[row] = (uint32_t)(first[c] + seen[c]++);
+    }
+
+    string block(n, '\0');
+    size_t row = 0;
+    for (size_t k = n; k > 0; k--) {
+        block[k - 1] = last[row < primary ? row : row - 1];
+        row = lf[row];
+    }
+    return block;
+}
+
+string BlockSort::mtf(const string& text) {
+    unsigned char order[Huffman::MAX_CHAR+1];
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        order[c] = (unsigned char)c;
+    string ranks(text.size(), '\0');
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = (unsigned char)text[i];
+        int r = 0;
+        while (order[r] != c)
+            r++;
+        memmove(order + 1, order, r);
+        order[0] = c;
+        ranks[i] = (char)r;
+    }
+    return ranks;
+}
+
+string BlockSort::unmtf(const string& ranks) {
+    unsigned char order[Huffman::MAX_CHAR+1];
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        order[c] = (unsigned char)c;
+    string text(ranks.size(), '\0');
+    for (size_t i = 0; i < ranks.size(); i++) {
+        int r = (unsigned char)ranks[i];
+        unsigned char c = order[r];
+        memmove(order + 1, order, r);
+        order[0] = c;
+        text[i] = (char)c;
+    }
+    return text;
+}
+
+string BlockSort::rleZeros(const string& text) {
+    string runs;
+    runs.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ) {
+        if (text[i] != '\0') {
+            runs += text[i++];
+            continue;
+        }
+        size_t run = 1;
+        while (run < 256 && i + run < text.size() && text[i + run] == '\0')
+            run++;
+        runs += '\0';
+        runs += (char)(run - 1);
+        i += run;
+    }
+    return runs;
+}
+
+string BlockSort::unrleZeros(const string& runs) {
+    string text;
+    text.reserve(runs.size() * 2);
+    for (size_t i = 0; i < runs.size(); i++) {
+        if (runs[i] != '\0') {
+            text += runs[i];
+            continue;
+        }
+        if (++i == runs.size())
+            throw invalid_argument("zero run missing its length");
+        text.append((size_t)(unsigned char)runs[i] + 1, '\0');
+    }
+    return text;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file BlockSort.h - Block-sorting (BWT + move-to-front + zero-run) high-ratio mode.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <cstdint>
+
+/**
+ * @class BlockSort - optional pre-transform stage in front of Huffman for archival data.
+ *
+ * The input is cut into blocks. Each block goes through a Burrows-Wheeler transform
+ * (built from a suffix array), then move-to-front, then zero-run run-length encoding,
+ * and the result is coded with its own Huffman table stored alongside it. Blocks are
+ * independent so they are transformed on several threads at once.
+ *
+ * Compressed layout, repeated for each block and ended by a rawLength of zero:
+ *     uint32 rawLength, uint32 primary, uint32 rleLength, 32-byte bitmap of the
+ *     characters in the runs, a count of each of them in character order (7 bits per
+ *     byte, low-order group first), uint32 bitCount, (bitCount+7)/8 bytes of codes
+ * A block that would not come out smaller is stored instead: uint32 rawLength, uint32 0
+ * in place of primary, then the rawLength bytes of the block.
+ */
+class BlockSort {
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+
+    /**
+     * @param blockSize  bytes of input per block (larger sorts better but uses more memory)
+     * @param threads    number of blocks transformed at the same time
+     */
+    explicit BlockSort(size_t blockSize = DEFAULT_BLOCK_SIZE, int threads = 1);
+
+    /**
+     * Compress all of in (to EOF) onto out.
+     *
+     * @param in   source text
+     * @param out  binary stream to receive the compressed blocks
+     */
+    void compress(std::istream& in, std::ostream& out) const;
+
+    /**
+     * Reverse compress().
+     *
+     * @param in   binary stream previously written by compress()
+     * @param out  receives the original text
+     * @throws invalid_argument  if the compressed stream is truncated or malformed
+     */
+    void decompress(std::istream& in, std::ostream& out) const;
+
+    /**
+     * Burrows-Wheeler transform of one block (the sentinel is implied, not stored).
+     *
+     * @param block    text to transform
+     * @param primary  receives the row of the sentinel, needed to invert the transform
+     * @return         last column of the sorted suffixes, same length as block
+     */
+    static std::string bwt(const std::string& block, uint32_t& primary);
+
+    /**
+     * Invert bwt().
+     */
+    static std::string unbwt(const std::string& last, uint32_t primary);
+
+    /**
+     * Move-to-front: each byte is replaced by its position in a recency list.
+     */
+    static std::string mtf(const std::string& text);
+
+    /**
+     * Invert mtf().
+     */
+    static std::string unmtf(const std::string& ranks);
+
+    /**
+     * Zero-run encoding: a run of up to 256 zero bytes becomes a zero followed by (run length - 1).
+     */
+    static std::string rleZeros(const std::string& text);
+
+    /**
+     * Invert rleZeros().
+     * @throws invalid_argument  if the final run is missing its length byte
+     */
+    static std::string unrleZeros(const std::string& runs);
+
+private:
+    size_t blockSize;
+    int threads;
+
+    static std::string encodeBlock(const std::string& raw);
+    static std::string decodeBlock(const std::string& record);
+    static bool readRecord(std::istream& in, std::string& record);
+};
@@ -0,0 +1,222 @@
+/**
+ * @file CanonicalCode.cpp - Minimum-redundancy canonical codes for very large alphabets.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "CanonicalCode.h"
+using namespace std;
+
+CanonicalCode::CanonicalCode(const vector<uint64_t>& frequencies) : lengths(), codes(), sorted(), maxLength(0) {
+    if (frequencies.size() > UINT32_MAX)
+        throw invalid_argument("too many symbols for a canonical code");
+    lengths.assign(frequencies.size(), 0);
+
+    // the symbols with counts, least frequent first
+    vector<uint32_t> order;
+    for (size_t s = 0; s < frequencies.size(); s++)
+        if (frequencies[s] != 0)
+            order.push_back((uint32_t)s);
+    if (order.empty())
+        throw invalid_argument("no symbols to code");
+    sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return frequencies[a] != frequencies[b] ? frequencies[a] < frequencies[b] : a < b;
+    });
+
+    // halving keeps the order, so the same order serves every attempt
+    vector<uint64_t> a(order.size());
+    for (int shift = 0; ; shift++) {
+        for (size_t i = 0; i < order.size(); i++)
+            a[i] = max(frequencies[order[i]] >> shift, (uint64_t)1);
+        codeLengths(a.data(), a.size());
+        if (a[0] <= (uint64_t)MAX_LENGTH)
+            break;
+    }
+    for (size_t i = 0; i < order.size(); i++)
+        lengths[order[i]] = (uint8_t)(a[i] != 0 ? a[i] : 1);
+    assign();
+}
+
+CanonicalCode::CanonicalCode(string filename) : lengths(), codes(), sorted(), maxLength(0) {
+    ifstream f;
+    f.open(filename, ios::binary | ios::in);
+    if (!f.is_open())
+        throw invalid_argument(string("cannot open file ") + filename + " to read canonical code");
+    uint32_t n;
+    if (!f.read((char *)&n, sizeof(n)))
+        throw invalid_argument(string("file ") + filename + " ended early");
+    lengths.resize(n);
+    if (n != 0 && !f.read((char *)lengths.data(), n))
+        throw invalid_argument(string("file ") + filename + " ended early");
+    assign();
+}
+
+void CanonicalCode::writeToFile(string filename) const {
+    ofstream f;
+    f.open(filename, ios::binary | ios::out);
+    if (!f.is_open())
+        throw invalid_argument(string("cannot open file ") + filename + " to write canonical code");
+    uint32_t n = (uint32_t)lengths.size();
+    f.write((const char *)&n, sizeof(n));
+    f.write((const char *)lengths.data(), n);
+}
+
+/*
+ * Three passes over the one array (Moffat and Katajainen):
+ *  1. left to right, pairing the two smallest of the leaves not yet used and the internal
+ *     nodes made so far, as in Huffman's algorithm. The internal nodes are made in
+ *     non-decreasing order, so they form a queue in a[0..next) and each pairing is a merge
+ *     of two sorted lists; a used internal node's slot is overwritten with its parent.
+ *  2. right to left, turning the parent indexes into depths (the root, a[n-2], is 0).
+ *  3. right to left, turning the number of internal nodes at each depth into the number of
+ *     leaves there, which get that depth as their code length.
+ */
+void CanonicalCode::codeLengths(uint64_t a[], size_t n) {
+    if (n == 0)
+        return;
+    if (n == 1) {
+        a[0] = 0;
+        return;
+    }
+
+    a[0] += a[1];
+    size_t root = 0;  // next internal node to pair
+    size_t leaf = 2;  // next leaf to pair
+    for (size_t next = 1; next < n - 1; next++) {
+        if (leaf >= n || a[root] < a[leaf]) {
+            a[next] = a[root];
+            a[root++] = next;
+        } else {
+            a[next] = a[leaf++];
+        }
+        if (leaf >= n || (root < next && a[root] < a[leaf])) {
+            a[next] += a[root];
+            a[root++] = next;
+        } else {
+            a[next] += a[leaf++];
+        }
+    }
+
+    a[n - 2] = 0;
+    for (size_t next = n - 2; next-- > 0; )
+        a[next] = a[a[next]] + 1;
+
+    uint64_t available = 1, used = 0, depth = 0;
+    size_t internal = n - 1;  // one past the next internal node (right to left)
+    size_t next = n;          // one past the next leaf to get a length
+    while (available > 0) {
+        while (internal > 0 && a[internal - 1] == depth) {
+            used++;
+            internal--;
+        }
+        while (available > used) {
+            a[--next] = depth;
+            available--;
+        }
+        available = 2 * used;
+        depth++;
+        used = 0;
+    }
+}
+
+void CanonicalCode::assign() {
+    memset(counts, 0, sizeof(counts));
+    maxLength = 0;
+    for (uint8_t length: lengths) {
+        if (length > MAX_LENGTH)
+            throw invalid_argument("code length over the maximum");
+        counts[length]++;
+        if (length > maxLength)
+            maxLength = length;
+    }
+    counts[0] = 0;
+
+    // first code of each length, and where its symbols start in sorted
+    uint64_t first[MAX_LENGTH+2];
+    uint64_t start[MAX_LENGTH+2];
+    uint64_t code = 0, index = 0;
+    for (int length = 1; length <= maxLength; length++) {
+        code = (code + counts[length - 1]) << 1;
+        first[length] = code;
+        start[length] = index;
+        index += counts[length];
+        if (counts[length] > (uint64_t(1) << length) - code)
+            throw invalid_argument("code lengths are not a prefix code");
+    }
+    if (index == 0)
+        throw invalid_argument("no symbols to code");
+
+    codes.assign(lengths.size(), 0);
+    sorted.assign(index, 0);
+    for (size_t s = 0; s < lengths.size(); s++) {
+        int length = lengths[s];
+        if (length == 0)
+            continue;
+        uint64_t value = first[length]++;
+        sorted[start[length]++] = (uint32_t)s;
+        // most significant bit first on the stream, so reversed into the low-order end
+        uint64_t bits = 0;
+        for (int i = 0; i < length; i++)
+            bits |= ((value >> (length - 1 - i)) & 1u) << i;
+        codes[s] = bits;
+    }
+}
+
+size_t CanonicalCode::encode(const uint32_t *src, size_t n, uint8_t *dst, size_t cap) const {
+    uint64_t pending = 0;  // bits not yet stored, first one in the low-order bit
+    int pendingLength = 0; // always < 8 between symbols
+    size_t out = 0;
+    size_t bitCount = 0;
+    for (size_t i = 0; i < n; i++) {
+        int length = codeLength(src[i]);
+        if (length == 0)
+            throw invalid_argument("symbol not in the sample: " + to_string(src[i]));
+        pending |= codes[src[i]] << pendingLength;
+        pendingLength += length;
+        bitCount += length;
+        for (; pendingLength >= 8; pendingLength -= 8) {
+            if (out >= cap)
+                throw length_error("encode output buffer too small");
+            dst[out++] = (uint8_t)pending;
+            pending >>= 8;
+        }
+    }
+    if (pendingLength > 0) {
+        if (out >= cap)
+            throw length_error("encode output buffer too small");
+        dst[out++] = (uint8_t)pending;
+    }
+    return bitCount;
+}
+
+size_t CanonicalCode::decode(const uint8_t *src, size_t bitCount, uint32_t *dst, size_t cap) const {
+    size_t pos = 0;
+    size_t out = 0;
+    while (pos < bitCount) {
+        // extend the code a bit at a time until it falls among the codes of its length
+        uint64_t code = 0, first = 0, index = 0;
+        int length = 0;
+        for (;;) {
+            if (pos >= bitCount)
+                throw invalid_argument("Bit stream early ending");
+            code |= (src[pos / 8] >> (pos % 8)) & 1u;
+            pos++;
+            length++;
+            if (length > maxLength)
+                throw invalid_argument("Code doesn't work");
+            if (code - first < counts[length])
+                break;
+            index += counts[length];
+            first = (first + counts[length]) << 1;
+            code <<= 1;
+        }
+        if (out >= cap)
+            throw length_error("decode output buffer too small");
+        dst[out++] = sorted[index + (code - first)];
+    }
+    return out;
+}
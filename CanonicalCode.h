@@ -0,0 +1,139 @@
+/**
+ * @file CanonicalCode.h - Minimum-redundancy canonical codes for very large alphabets.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class CanonicalCode - Huffman-optimal codes for millions of symbols (word or token ids).
+ *
+ * Huffman builds its tree from a priority queue of heap-allocated nodes, which for a
+ * million-symbol alphabet means millions of allocations and around a hundred bytes per
+ * symbol. Here the code lengths are computed in place in an array of the sorted counts
+ * (Moffat and Katajainen, "In-place calculation of minimum-redundancy codes", 1995): O(n)
+ * time after the sort and no memory beyond the array. No tree is ever built; the codes are
+ * assigned canonically from the lengths alone (shorter codes first, equal lengths in
+ * symbol order), so a saved code is just one length byte per symbol.
+ *
+ * Bits are packed as in the rest of this library, the first bit of the stream in the
+ * low-order bit of the first byte; each code goes out most significant bit first, so
+ * decoding walks the lengths in order without any table per symbol.
+ *
+ * Codes are at most MAX_LENGTH bits: if the counts would need longer ones (only possible
+ * with totals in the hundreds of billions), the counts are halved until they fit.
+ * Only symbols with a non-zero count have codes.
+ */
+class CanonicalCode {
+public:
+    static const int MAX_LENGTH = 56;
+
+    /**
+     * Build the codes from symbol counts.
+     *
+     * @param frequencies  observation count of each symbol 0..frequencies.size()-1
+     * @throws invalid_argument  if every count is zero or there are over 2^32 symbols
+     */
+    explicit CanonicalCode(const std::vector<uint64_t>& frequencies);
+
+    /**
+     * Load codes from a previously saved file (via writeToFile).
+     * @param filename  path to file previously saved via writeToFile() method
+     */
+    explicit CanonicalCode(std::string filename);
+
+    /**
+     * Write the code lengths out to the given file, from which the same codes are rebuilt.
+     * @param filename  name of the file to write (will overwrite any existing file of the same name)
+     */
+    void writeToFile(std::string filename) const;
+
+    /**
+     * Replace the counts in a with the lengths of minimum-redundancy codes for them.
+     *
+     * @param a  n counts in non-decreasing order; on return, the code length of each
+     *           (so in non-increasing order); a single count gets length 0
+     * @param n  number of counts
+     * @pre      the sum of the counts fits in 64 bits
+     */
+    static void codeLengths(uint64_t a[], size_t n);
+
+    /**
+     * Encode n symbols from src into dst.
+     *
+     * @param src  symbols to encode
+     * @param n    number of symbols in src
+     * @param dst  receives the packed codes; unused bits of the final byte are zeros
+     * @param cap  bytes available in dst (encodedBound(n) is always enough)
+     * @return     number of bits written, i.e., (return+7)/8 bytes of dst were used
+     * @throws invalid_argument  if src has a symbol with no code
+     * @throws length_error      if dst is too small
+     */
+    size_t encode(const uint32_t *src, size_t n, uint8_t *dst, size_t cap) const;
+
+    /**
+     * Decode bitCount bits from src into dst.
+     *
+     * @param src       packed codes as written by encode()
+     * @param bitCount  number of bits of src to decode
+     * @param dst       receives the symbols
+     * @param cap       symbols available in dst
+     * @return          number of symbols written
+     * @throws invalid_argument  if the bits end in the middle of a code or match no code
+     * @throws length_error      if dst is too small
+     */
+    size_t decode(const uint8_t *src, size_t bitCount, uint32_t *dst, size_t cap) const;
+
+    /**
+     * Bytes of output that encoding n symbols can possibly take.
+     */
+    size_t encodedBound(size_t n) const {
+        return (size_t)(((uint64_t)n * maxLength + 7) / 8);
+    }
+
+    /**
+     * Number of symbols in the alphabet (with or without codes).
+     */
+    size_t size() const {
+        return lengths.size();
+    }
+
+    /**
+     * Length in bits of the code for symbol (0 if it has no code).
+     */
+    int codeLength(uint32_t symbol) const {
+        return symbol < lengths.size() ? lengths[symbol] : 0;
+    }
+
+    /**
+     * The code for symbol, first bit in the low-order bit.
+     */
+    uint64_t codeBits(uint32_t symbol) const {
+        return codes[symbol];
+    }
+
+    /**
+     * Length in bits of the longest code.
+     */
+    int maxCodeLength() const {
+        return maxLength;
+    }
+
+private:
+    std::vector<uint8_t> lengths;   // of each symbol, 0 for none
+    std::vector<uint64_t> codes;    // of each symbol, first bit in the low-order bit
+    std::vector<uint32_t> sorted;   // the symbols with codes in canonical order
+    uint64_t counts[MAX_LENGTH+1];  // number of codes of each length
+    int maxLength;
+
+    /**
+     * Assign the codes (and the decoding tables) from lengths.
+     * @throws invalid_argument  if lengths are not those of a complete prefix code
+     */
+    void assign();
+};
@@ -0,0 +1,63 @@
+/**
+ * @file CheckpointIndex.cpp - Sparse map from text offsets to bit offsets in a coded stream.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <fstream>
+#include <stdexcept>
+#include "CheckpointIndex.h"
+using namespace std;
+
+CheckpointIndex::CheckpointIndex(size_t interval) : every(interval), length(0), offsets() {
+    if (interval == 0)
+        throw invalid_argument("checkpoint interval must be positive");
+}
+
+void CheckpointIndex::clear() {
+    length = 0;
+    offsets.clear();
+}
+
+uint64_t CheckpointIndex::bitOffset(size_t i) const {
+    if (i >= offsets.size())
+        throw out_of_range("no such checkpoint");
+    return offsets[i];
+}
+
+/*
+ * File layout: uint64 interval, uint64 text length, then one uint64 bit offset per checkpoint.
+ */
+void CheckpointIndex::writeToFile(string filename) const {
+    ofstream f;
+    f.open(filename, ios::binary | ios::out);
+    if (!f.is_open())
+        throw invalid_argument(string("cannot open file ") + filename + " to write checkpoint index");
+    uint64_t header[2] = {every, length};
+    f.write((const char *)header, sizeof(header));
+    f.write((const char *)offsets.data(), offsets.size() * sizeof(uint64_t));
+}
+
+CheckpointIndex::CheckpointIndex(string filename) : every(0), length(0), offsets() {
+    ifstream f;
+    f.open(filename, ios::binary | ios::in);
+    if (!f.is_open())
+        throw invalid_argument(string("cannot open file ") + filename + " to read checkpoint index");
+    uint64_t header[2];
+    if (!f.read((char *)header, sizeof(header)) || header[0] == 0)
+        throw invalid_argument(string("file ") + filename + " is not a checkpoint index");
+    every = header[0];
+    length = header[1];
+
+    // check the count against what the file holds before allocating for it
+    uint64_t count = length / every + (length % every != 0);
+    streampos start = f.tellg();
+    f.seekg(0, ios::end);
+    streampos end = f.tellg();
+    if (!f || end < start || count > (uint64_t)(end - start) / sizeof(uint64_t))
+        throw invalid_argument(string("file ") + filename + " ended early");
+    f.seekg(start);
+    offsets.resize(count);
+    if (!f.read((char *)offsets.data(), offsets.size() * sizeof(uint64_t)))
+        throw invalid_argument(string("file ") + filename + " ended early");
+}
@@ -0,0 +1,90 @@
+/**
+ * @file CheckpointIndex.h - Sparse map from text offsets to bit offsets in a coded stream.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class CheckpointIndex - where every interval'th character of the text starts in the codes.
+ *
+ * Filled in by Huffman::encode() and used by Huffman::decodeRange() to start decoding at
+ * the checkpoint just before a wanted offset instead of at bit 0. Checkpoint i is the bit
+ * offset of character i*interval(), so at most interval()-1 characters are decoded and
+ * thrown away to reach any offset.
+ */
+class CheckpointIndex {
+public:
+    static const size_t DEFAULT_INTERVAL = 4096;
+
+    /**
+     * Construct an empty index, suitable for filling in by Huffman::encode().
+     * @param interval  characters between checkpoints (smaller is faster to seek, but bigger)
+     */
+    explicit CheckpointIndex(size_t interval = DEFAULT_INTERVAL);
+
+    /**
+     * Load an index from a previously saved file (via writeToFile).
+     * @param filename  path to file previously saved via writeToFile() method
+     * @throws invalid_argument  if the file cannot be read, or is shorter than its header says
+     */
+    explicit CheckpointIndex(std::string filename);
+
+    /**
+     * Write the index out to the given file.
+     * @param filename  name of the file to write (will overwrite any existing file of the same name)
+     */
+    void writeToFile(std::string filename) const;
+
+    /**
+     * Drop all checkpoints, keeping the interval.
+     */
+    void clear();
+
+    /**
+     * Record that the next character of the text starts at the given bit offset.
+     * Only every interval'th call actually adds a checkpoint.
+     * @param bitOffset  offset of the character's code from the start of the coded stream
+     */
+    void observe(uint64_t bitOffset) {
+        if (length++ % every == 0)
+            offsets.push_back(bitOffset);
+    }
+
+    /**
+     * Characters between checkpoints.
+     */
+    size_t interval() const {
+        return every;
+    }
+
+    /**
+     * Number of characters of text that were indexed.
+     */
+    uint64_t textLength() const {
+        return length;
+    }
+
+    /**
+     * Number of checkpoints.
+     */
+    size_t size() const {
+        return offsets.size();
+    }
+
+    /**
+     * Bit offset of character i*interval().
+     * @throws out_of_range  if i >= size()
+     */
+    uint64_t bitOffset(size_t i) const;
+
+private:
+    size_t every;
+    uint64_t length;
+    std::vector<uint64_t> offsets;
+};
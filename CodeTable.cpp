@@ -0,0 +1,426 @@
+/**
+ * @file CodeTable.cpp - Flat encode/decode tables for Huffman codes.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include "CodeTable.h"
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CODETABLE_AVX2 1
+#endif
+using namespace std;
+
+namespace {
+
+/*
+ * Bit packer for encodeAvx2(): appends up to 64 bits at a time and stores whole 64-bit
+ * words, which only ever hold real bits (so a big enough dst is never overrun).
+ */
+struct WordPacker {
+    uint8_t *dst;
+    size_t cap;
+    size_t out = 0;
+    uint64_t pending = 0;  // bits not yet stored, first one in the low-order bit
+    int pendingLength = 0; // always < 64
+
+    WordPacker(uint8_t *dst, size_t cap) : dst(dst), cap(cap) {}
+
+    void put(uint64_t bits, int length) {
+        pending |= bits << pendingLength;
+        int total = pendingLength + length;
+        if (total < 64) {
+            pendingLength = total;
+            return;
+        }
+        if (out + 8 > cap)
+            throw length_error("encode output buffer too small");
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(dst + out, &pending, sizeof(pending));
+#else
+        for (int b = 0; b < 8; b++)
+            dst[out + b] = (uint8_t)(pending >> (8 * b));
+#endif
+        out += 8;
+        pending = pendingLength == 0 ? 0 : bits >> (64 - pendingLength);
+        pendingLength = total - 64;
+    }
+
+    void flush() {
+        for (; pendingLength > 0; pendingLength -= 8) {
+            if (out >= cap)
+                throw length_error("encode output buffer too small");
+            dst[out++] = (uint8_t)pending;
+            pending >>= 8;
+        }
+        pendingLength = 0;
+    }
+};
+
+}
+
+CodeTable::CodeTable() : maxLength(0), multiBuilt(false) {
+    memset(codes, 0, sizeof(codes));
+    memset(lookup, 0, sizeof(lookup));
+    memset(tree, 0, sizeof(tree));
+    memset(multi, 0, sizeof(multi));
+}
+
+void CodeTable::build(const Bits codes[]) {
+    *this = CodeTable();
+
+    // the tree, as an array of internal nodes with node 0 as the root
+    int nodes = 1;
+    for (int c = 0; c <= MAX_CHAR; c++) {
+        int length = codes[c].bitsUsed();
+        if (length == 0)
+            continue;
+        unsigned int bits = codes[c].asInteger();
+        this->codes[c].bits = bits;
+        this->codes[c].length = length;
+        if (length > maxLength)
+            maxLength = length;
+        int node = 0;
+        for (int i = 0; i < length - 1; i++) {
+            uint16_t &child = tree[node][(bits >> i) & 1u];
+            if (child & LEAF)
+                throw invalid_argument("codes are not a prefix code");
+            if (child == 0) {
+                if (nodes > MAX_CHAR)
+                    throw invalid_argument("codes are not a prefix code");
+                child = (uint16_t)nodes++;
+            }
+            node = child;
+        }
+        uint16_t &leaf = tree[node][(bits >> (length - 1)) & 1u];
+        if (leaf != 0)
+            throw invalid_argument("codes are not a prefix code");
+        leaf = (uint16_t)(LEAF | c);
+    }
+
+    // every LOOKUP_BITS pattern either finishes a code or lands on an internal node
+    for (unsigned int i = 0; i < (1u << LOOKUP_BITS); i++) {
+        uint16_t node = 0;
+        int depth = 0;
+        while (depth < LOOKUP_BITS && !(node & LEAF)) {
+            node = tree[node][(i >> depth) & 1u];
+            depth++;
+            if (node == 0)
+                break;
+        }
+        if (node == 0)
+            continue;
+        lookup[i].valid = 1;
+        lookup[i].value = (uint16_t)(node & ~LEAF);
+        lookup[i].length = (node & LEAF) ? (uint8_t)depth : 0;
+    }
+
+    int lengths[MAX_CHAR+1];
+    for (int c = 0; c <= MAX_CHAR; c++)
+        lengths[c] = this->codes[c].length;
+    if (multiSymbolPays(lengths))
+        buildMulti();
+}
+
+bool CodeTable::wellFormed() const {
+    Bits given[MAX_CHAR+1];
+    for (int c = 0; c <= MAX_CHAR; c++) {
+        uint32_t length = codes[c].length;
+        if (length > (uint32_t)Bits::MAX_BITS || (length < 32 && (codes[c].bits >> length) != 0))
+            return false;
+        given[c] = Bits(codes[c].bits, (int)length);
+    }
+    unique_ptr<CodeTable> rebuilt(new CodeTable());  // too big for the stack
+    try {
+        rebuilt->build(given);
+    } catch (const invalid_argument&) {
+        return false;
+    }
+    return memcmp(codes, rebuilt->codes, sizeof(codes)) == 0 &&
+           memcmp(lookup, rebuilt->lookup, sizeof(lookup)) == 0 &&
+           memcmp(tree, rebuilt->tree, sizeof(tree)) == 0 &&
+           maxLength == rebuilt->maxLength && multiBuilt == rebuilt->multiBuilt &&
+           memcmp(multi, rebuilt->multi, sizeof(multi)) == 0;
+}
+
+bool CodeTable::multiSymbolPays(const int lengths[]) {
+    double kraft = 0, expected = 0;
+    for (int c = 0; c <= MAX_CHAR; c++)
+        if (lengths[c] != 0) {
+            double p = 1.0 / (double)(uint64_t(1) << (lengths[c] < 63 ? lengths[c] : 63));
+            kraft += p;
+            expected += p * lengths[c];
+        }
+    return kraft > 0 && 2 * expected / kraft <= MULTI_BITS;
+}
+
+void CodeTable::buildMulti() {
+    // every whole code in each window, walking the tree from where the last one ended
+    multiBuilt = true;
+    for (unsigned int w = 0; w < (1u << MULTI_BITS); w++) {
+        Multi &entry = multi[w];
+        int start = 0;
+        while (entry.count < MULTI_MAX) {
+            uint16_t node = 0;
+            int pos = start;
+            while (pos < MULTI_BITS) {
+                node = tree[node][(w >> pos) & 1u];
+                pos++;
+                if (node == 0 || (node & LEAF))
+                    break;
+            }
+            if (!(node & LEAF))
+                break;  // no code, or one that runs past the window
+            entry.symbols[entry.count++] = (uint8_t)(node & ~LEAF);
+            start = pos;
+        }
+        entry.length = (uint8_t)start;
+    }
+}
+
+size_t CodeTable::encodedBound(size_t n) const {
+    return (n * maxLength + 7) / 8;
+}
+
+size_t CodeTable::encode(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const {
+#ifdef CODETABLE_AVX2
+    static const bool avx2 = vectorized();
+    if (avx2)
+        return encodeAvx2(src, n, dst, cap);
+#endif
+    return encodeScalar(src, n, dst, cap);
+}
+
+bool CodeTable::vectorized() {
+#ifdef CODETABLE_AVX2
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+#ifdef CODETABLE_AVX2
+/*
+ * Eight characters per round: gather their {bits, length} entries, then merge neighbours
+ * with variable shifts, each merge shifting the right-hand code by the combined length to
+ * its left (a prefix sum over the lanes done as a tree). Any code fits 32 bits, so pairs
+ * fit a 64-bit lane; when no code is over 16 bits, pairs of pairs fit too and a round is
+ * only two appends to the running bit position instead of eight.
+ */
+__attribute__((target("avx2")))
+size_t CodeTable::encodeAvx2(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const {
+    WordPacker packer(dst, cap);
+    size_t bitCount = 0;
+    const int *base = (const int *)codes;
+    const __m256i low32 = _mm256_set1_epi64x(0xffffffff);
+    const __m256i zero = _mm256_setzero_si256();
+    bool quads = maxLength <= 16;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i)));
+        __m256i bits = _mm256_i32gather_epi32(base, index, sizeof(Code));
+        __m256i lengths = _mm256_i32gather_epi32(base + 1, index, sizeof(Code));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(lengths, zero)) != 0)
+            break;  // a character with no code: let the loop below report it
+
+        // each 64-bit lane: the even character's code, then the odd one's after it
+        __m256i evenLengths = _mm256_and_si256(lengths, low32);
+        __m256i pairBits = _mm256_or_si256(_mm256_and_si256(bits, low32),
+                                           _mm256_sllv_epi64(_mm256_srli_epi64(bits, 32), evenLengths));
+        __m256i pairLengths = _mm256_add_epi64(evenLengths, _mm256_srli_epi64(lengths, 32));
+        if (quads) {
+            // lanes 0 and 2: their own pair, then the pair from lane 1 or 3 after it
+            __m256i quadBits = _mm256_or_si256(pairBits, _mm256_sllv_epi64(_mm256_srli_si256(pairBits, 8), pairLengths));
+            __m256i quadLengths = _mm256_add_epi64(pairLengths, _mm256_srli_si256(pairLengths, 8));
+            int l0 = _mm256_extract_epi64(quadLengths, 0);
+            int l2 = _mm256_extract_epi64(quadLengths, 2);
+            packer.put(_mm256_extract_epi64(quadBits, 0), l0);
+            packer.put(_mm256_extract_epi64(quadBits, 2), l2);
+            bitCount += l0 + l2;
+        } else {
+            alignas(32) uint64_t pb[4], pl[4];
+            _mm256_store_si256((__m256i *)pb, pairBits);
+            _mm256_store_si256((__m256i *)pl, pairLengths);
+            for (int k = 0; k < 4; k++) {
+                packer.put(pb[k], (int)pl[k]);
+                bitCount += pl[k];
+            }
+        }
+    }
+    for (; i < n; i++) {
+        const Code &code = codes[src[i]];
+        if (code.length == 0)
+            throw invalid_argument("character not in the sample: " + to_string(src[i]));
+        packer.put(code.bits, code.length);
+        bitCount += code.length;
+    }
+    packer.flush();
+    return bitCount;
+}
+#else
+size_t CodeTable::encodeAvx2(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const {
+    return encodeScalar(src, n, dst, cap);
+}
+#endif
+
+size_t CodeTable::encodeScalar(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const {
+    uint64_t pending = 0;  // bits not yet stored, first one in the low-order bit
+    int pendingLength = 0;
+    size_t out = 0;
+    size_t bitCount = 0;
+    for (size_t i = 0; i < n; i++) {
+        const Code &code = codes[src[i]];
+        if (code.length == 0)
+            throw invalid_argument("character not in the sample: " + to_string(src[i]));
+        pending |= (uint64_t)code.bits << pendingLength;
+        pendingLength += code.length;
+        bitCount += code.length;
+        if (pendingLength >= 32) {
+            if (out + 4 > cap)
+                throw length_error("encode output buffer too small");
+            for (int b = 0; b < 4; b++)
+                dst[out++] = (uint8_t)(pending >> (8 * b));
+            pending >>= 32;
+            pendingLength -= 32;
+        }
+    }
+    for (; pendingLength > 0; pendingLength -= 8) {
+        if (out >= cap)
+            throw length_error("encode output buffer too small");
+        dst[out++] = (uint8_t)pending;
+        pending >>= 8;
+    }
+    return bitCount;
+}
+
+/*
+ * At least 57 bits starting at bitPos (zeros past the end of src) in the low-order bits.
+ */
+uint64_t CodeTable::peek(const uint8_t *src, size_t bytes, size_t bitPos) {
+    size_t at = bitPos / 8;
+    uint64_t window = 0;
+    if (at + 8 <= bytes) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(&window, src + at, sizeof(window));
+#else
+        for (int b = 0; b < 8; b++)
+            window |= (uint64_t)src[at + b] << (8 * b);
+#endif
+    } else {
+        for (int b = 0; at + b < bytes; b++)
+            window |= (uint64_t)src[at + b] << (8 * b);
+    }
+    return window >> (bitPos % 8);
+}
+
+size_t CodeTable::decodeMulti(const uint8_t *src, size_t bytes, size_t bitCount, size_t &pos,
+                               uint8_t *dst, size_t cap) const {
+    // stay a whole window inside the bits and room for the symbols of three lookups inside
+    // dst, so only the caller's loop has to check either as it finishes up
+    const uint32_t mask = (1u << MULTI_BITS) - 1;
+    size_t out = 0;
+    while (bitCount - pos >= 64 && cap - out >= 4 * MULTI_MAX) {
+        uint64_t window = peek(src, bytes, pos);
+        const Multi *entry = &multi[window & mask];
+        if (entry->count == 0) {
+            uint8_t c;
+            int length = decodeOne(window, c);
+            if (length == 0)
+                throw invalid_argument("Code doesn't work");
+            dst[out++] = c;
+            pos += length;
+            continue;
+        }
+        // three lookups use at most 3 * MULTI_BITS of the 57 bits peek() gives
+        int used = 0;
+        for (int k = 0; k < 3 && entry->count != 0; k++) {
+            memcpy(dst + out, entry->symbols, MULTI_MAX);
+            out += entry->count;
+            used += entry->length;
+            entry = &multi[(window >> used) & mask];
+        }
+        pos += used;
+    }
+    return out;
+}
+
+size_t CodeTable::decode(const uint8_t *src, size_t bitCount, uint8_t *dst, size_t cap) const {
+    size_t bytes = (bitCount + 7) / 8;
+    size_t pos = 0;
+    size_t out = 0;
+    if (multiBuilt)
+        out = decodeMulti(src, bytes, bitCount, pos, dst, cap);
+    while (pos < bitCount) {
+        uint64_t window = peek(src, bytes, pos);
+        uint8_t c;
+        size_t length = decodeOne(window, c);
+        if (length == 0)
+            throw invalid_argument("Code doesn't work");
+        if (pos + length > bitCount)
+            throw invalid_argument("Bit stream early ending");
+        if (out >= cap)
+            throw length_error("decode output buffer too small");
+        dst[out++] = c;
+        pos += length;
+    }
+    return out;
+}
+
+size_t CodeTable::decodeCount(const uint8_t *src, size_t bytes, uint8_t *dst, size_t count) const {
+    size_t bitCount = 8 * bytes;
+    size_t pos = 0;
+    size_t out = 0;
+    if (multiBuilt)
+        out = decodeMulti(src, bytes, bitCount, pos, dst, count);
+    for (; out < count; out++) {
+        uint8_t c;
+        size_t length = decodeOne(peek(src, bytes, pos), c);
+        if (length == 0)
+            throw invalid_argument("Code doesn't work");
+        if (pos + length > bitCount)
+            throw invalid_argument("Bit stream early ending");
+        dst[out] = c;
+        pos += length;
+    }
+    return pos;
+}
+
+void PairTable::build(const CodeTable& table) {
+    pairs.assign(1u << 16, 0);
+    for (int a = 0; a <= CodeTable::MAX_CHAR; a++)
+        for (int b = 0; b <= CodeTable::MAX_CHAR; b++) {
+            uint32_t lengthA = table.codeLength((uint8_t)a);
+            uint32_t length = lengthA + table.codeLength((uint8_t)b);
+            if (lengthA == 0 || length == lengthA || length > (uint32_t)MAX_LENGTH)
+                continue;
+            uint32_t bits = table.codeBits((uint8_t)a) | table.codeBits((uint8_t)b) << lengthA;
+            pairs[a | b << 8] = bits | length << 24;
+        }
+}
+
+size_t PairTable::encode(const CodeTable& table, const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const {
+    WordPacker packer(dst, cap);
+    size_t bitCount = 0;
+    size_t i = 0;
+    while (i < n) {
+        uint32_t pair = i + 1 < n ? pairs[src[i] | src[i + 1] << 8] : 0;
+        if (pair != 0) {
+            packer.put(pair & 0xffffff, pair >> 24);
+            bitCount += pair >> 24;
+            i += 2;
+            continue;
+        }
+        // a pair too long to join, the last character, or one with no code
+        int length = table.codeLength(src[i]);
+        if (length == 0)
+            throw invalid_argument("character not in the sample: " + to_string(src[i]));
+        packer.put(table.codeBits(src[i]), length);
+        bitCount += length;
+        i++;
+    }
+    packer.flush();
+    return bitCount;
+}
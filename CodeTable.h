@@ -0,0 +1,266 @@
+/**
+ * @file CodeTable.h - Flat encode/decode tables for Huffman codes.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Bits.h"
+
+/**
+ * @class CodeTable - Huffman codes laid out for coding straight between byte buffers.
+ *
+ * Bits are packed in the same order as Bits and BitStreamF: the first bit of the stream is
+ * the low-order bit of the first byte. Encoding is one table lookup per character; on x86
+ * processors with AVX2, eight lookups are gathered at once and their codes merged into
+ * 64-bit words before they meet the running bit position (chosen at run time; the output
+ * is the same byte for byte). Decoding
+ * looks up the next LOOKUP_BITS bits at once, and only codes longer than that walk the
+ * (array-based) tree for their remaining bits.
+ *
+ * When the codes are short enough that two of them usually fit in MULTI_BITS (most text;
+ * see multiSymbolPays()), decoding first looks up the next MULTI_BITS bits in a second
+ * table giving every whole code in them (up to MULTI_MAX), so one lookup usually yields
+ * several characters. The encoding counterpart, a table of pairs of characters, is a
+ * PairTable.
+ *
+ * The table holds no pointers and is never modified after build(), so it can be shared by
+ * any number of threads.
+ */
+class CodeTable {
+public:
+    static const int LOOKUP_BITS = 11;
+    static const int MAX_CHAR = 255;
+    static const int MULTI_BITS = 12;
+    static const int MULTI_MAX = 4;
+
+    /**
+     * Construct an empty table which can encode nothing.
+     */
+    CodeTable();
+
+    /**
+     * Fill in the tables from a complete set of prefix codes.
+     *
+     * @param codes  code of each character 0..MAX_CHAR, empty for characters not in the code
+     * @throws invalid_argument  if the codes are not a prefix code
+     */
+    void build(const Bits codes[]);
+
+    /**
+     * Whether the tables are exactly what build() makes from this table's own codes, which
+     * must be a prefix code of at most Bits::MAX_BITS-bit codes: a check for a table whose
+     * bytes came from outside (see ModelRegistry::mapFile()), since decoding and encoding
+     * trust every index and length in it.
+     */
+    bool wellFormed() const;
+
+    /**
+     * Encode n characters from src into dst.
+     *
+     * @param src  characters to encode
+     * @param n    number of characters in src
+     * @param dst  receives the packed codes; unused bits of the final byte are zeros
+     * @param cap  bytes available in dst (encodedBound(n) is always enough)
+     * @return     number of bits written, i.e., (return+7)/8 bytes of dst were used
+     * @throws invalid_argument  if src has a character with no code
+     * @throws length_error      if dst is too small
+     */
+    size_t encode(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const;
+
+    /**
+     * Same as encode(), always one character at a time (what encode() does without AVX2).
+     */
+    size_t encodeScalar(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const;
+
+    /**
+     * Whether encode() uses the AVX2 kernel on this processor.
+     */
+    static bool vectorized();
+
+    /**
+     * Whether build() made the multi-symbol decode table for these codes.
+     */
+    bool multiSymbol() const {
+        return multiBuilt;
+    }
+
+    /**
+     * Whether multi-symbol tables pay for themselves with these code lengths: a code of
+     * length l stands for a character of probability about 2^-l, so the expected code
+     * length must leave room for at least two codes in a MULTI_BITS lookup.
+     *
+     * @param lengths  code length of each character 0..MAX_CHAR (0 for no code)
+     */
+    static bool multiSymbolPays(const int lengths[]);
+
+    /**
+     * Decode bitCount bits from src into dst.
+     *
+     * @param src       packed codes as written by encode()
+     * @param bitCount  number of bits of src to decode
+     * @param dst       receives the characters
+     * @param cap       bytes available in dst
+     * @return          number of characters written
+     * @throws invalid_argument  if the bits end in the middle of a code or match no code
+     * @throws length_error      if dst is too small
+     */
+    size_t decode(const uint8_t *src, size_t bitCount, uint8_t *dst, size_t cap) const;
+
+    /**
+     * Decode exactly count characters from the start of src, ignoring whatever follows them.
+     *
+     * @param src    packed codes as written by encode()
+     * @param bytes  bytes available in src
+     * @param dst    receives the count characters
+     * @param count  number of characters to decode
+     * @return       number of bits the count codes took
+     * @throws invalid_argument  if src ends before count codes or has bits that match no code
+     */
+    size_t decodeCount(const uint8_t *src, size_t bytes, uint8_t *dst, size_t count) const;
+
+    /**
+     * Bytes of output that encoding n characters can possibly take.
+     */
+    size_t encodedBound(size_t n) const;
+
+    /**
+     * Length in bits of the longest code (0 for an empty table).
+     */
+    int maxCodeLength() const {
+        return maxLength;
+    }
+
+    /**
+     * Length in bits of the code for c (0 if c has no code).
+     */
+    int codeLength(uint8_t c) const {
+        return codes[c].length;
+    }
+
+    /**
+     * The code for c, first bit in the low-order bit.
+     */
+    uint32_t codeBits(uint8_t c) const {
+        return codes[c].bits;
+    }
+
+    /**
+     * Decode the first code in window (first bit in the low-order bit).
+     *
+     * @param window  at least the next maximum-code-length bits of the stream
+     * @param c       receives the decoded character
+     * @return        length of the code that was used, or 0 if window starts with no code
+     */
+    int decodeOne(uint64_t window, uint8_t &c) const {
+        const Lookup &entry = lookup[window & ((1u << LOOKUP_BITS) - 1)];
+        if (!entry.valid)
+            return 0;
+        if (entry.length != 0) {
+            c = (uint8_t)entry.value;
+            return entry.length;
+        }
+        // a long code: finish it one bit at a time from the node the lookup reached
+        uint16_t node = entry.value;
+        int length = LOOKUP_BITS;
+        do {
+            node = tree[node][(window >> length) & 1u];
+            length++;
+            if (node == 0)
+                return 0;
+        } while (!(node & LEAF));
+        c = (uint8_t)(node & ~LEAF);
+        return length;
+    }
+
+private:
+    /*
+     * A child in the tree: either LEAF|character or the index of another internal node.
+     * Zero is never a child (it is the root), so it marks a missing branch.
+     */
+    static const uint16_t LEAF = 0x8000;
+
+    struct Code {
+        uint32_t bits;
+        uint32_t length;
+    };
+
+    struct Lookup {
+        uint16_t value;  // character, or internal node reached after LOOKUP_BITS bits
+        uint8_t length;  // bits used if value is a character, 0 if it is a node
+        uint8_t valid;   // 0 if no code starts with these bits
+    };
+
+    struct Multi {
+        uint8_t symbols[MULTI_MAX];  // the whole codes in the window, in order
+        uint8_t count;               // how many; 0 if the window starts with a long code
+        uint8_t length;              // bits they take
+        uint16_t unused;
+    };
+
+    Code codes[MAX_CHAR+1];
+    Lookup lookup[1 << LOOKUP_BITS];
+    uint16_t tree[MAX_CHAR+1][2];
+    int maxLength;
+    bool multiBuilt;
+    Multi multi[1 << MULTI_BITS];  // indexed by the next MULTI_BITS bits, if multiBuilt
+
+    void buildMulti();
+
+    /*
+     * decode() with the multi-symbol table, for as long as no end is near.
+     * @return  number of characters written; pos is moved past them
+     */
+    size_t decodeMulti(const uint8_t *src, size_t bytes, size_t bitCount, size_t &pos,
+                       uint8_t *dst, size_t cap) const;
+
+    static uint64_t peek(const uint8_t *src, size_t bytes, size_t bitPos);
+
+    size_t encodeAvx2(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const;
+};
+
+/**
+ * @class PairTable - the codes of every pair of characters, joined, for encoding two
+ * characters per lookup.
+ *
+ * Indexed by the next two characters as one 16-bit number, so it takes 256K: unlike a
+ * CodeTable it lives on the heap and is never mapped from a file. Only worth building for
+ * codes where CodeTable::multiSymbolPays() and on processors where CodeTable::encode()
+ * has no AVX2 kernel (which already joins codes eight characters at a time).
+ */
+class PairTable {
+public:
+    static const int MAX_LENGTH = 24;
+
+    /**
+     * Construct an empty table (see empty()).
+     */
+    PairTable() {}
+
+    /**
+     * Fill in the table from the codes of a CodeTable.
+     */
+    void build(const CodeTable& table);
+
+    /**
+     * Whether build() has not been called, so encode() may not be.
+     */
+    bool empty() const {
+        return pairs.empty();
+    }
+
+    /**
+     * Same as table.encode(), two characters per lookup (pairs whose joined codes are over
+     * MAX_LENGTH bits are coded one at a time).
+     * @pre  built from table
+     */
+    size_t encode(const CodeTable& table, const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const;
+
+private:
+    // indexed by first | second << 8: both codes, the second after the first, in the low
+    // 24 bits and their length in the high 8; 0 if either has no code or they are too long
+    std::vector<uint32_t> pairs;
+};
@@ -0,0 +1,131 @@
+/**
+ * @file CodecService.cpp - In-process compress/decompress jobs run on a work-stealing pool.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <cmath>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "CodecService.h"
+#include "MessageBatch.h"
+using namespace std;
+
+CodecService::CodecService(int threads) : pool(threads) {
+    resetStats();
+}
+
+future<CodecService::Result> CodecService::compress(Huffman::Shared model, string payload) {
+    return submit(move(model), move(payload), [](const Huffman& huffman, string& input, string& output) {
+        vector<string> messages(1);
+        messages[0].swap(input);
+        vector<uint64_t> offsets;
+        MessageBatch(huffman).encode(messages, output, offsets);
+    });
+}
+
+future<CodecService::Result> CodecService::decompress(Huffman::Shared model, string record) {
+    return submit(move(model), move(record), [](const Huffman& huffman, string& input, string& output) {
+        if (MessageBatch(huffman).decodeAt(input, 0, output) != input.size())
+            throw invalid_argument("compressed record has trailing bytes");
+    });
+}
+
+template <typename Work>
+future<CodecService::Result> CodecService::submit(Huffman::Shared model, string input, Work work) {
+    if (!model)
+        throw invalid_argument("a job needs a model");
+    // the pool's tasks must be copyable, so the one-shot state is shared with the task
+    struct Job {
+        Huffman::Shared model;
+        string input;
+        promise<Result> done;
+        Clock::time_point submitted;
+    };
+    shared_ptr<Job> job = make_shared<Job>();
+    job->model = move(model);
+    job->input = move(input);
+    job->submitted = Clock::now();
+    future<Result> result = job->done.get_future();
+
+    pool.submit([this, job, work]() {
+        Clock::time_point started = Clock::now();
+        Result out;
+        exception_ptr error;
+        try {
+            work(*job->model, job->input, out.data);
+        } catch (...) {
+            error = current_exception();
+        }
+        Clock::time_point finished = Clock::now();
+        out.queueSeconds = chrono::duration<double>(started - job->submitted).count();
+        out.runSeconds = chrono::duration<double>(finished - started).count();
+        // counted before the caller can see the result, so stats() always includes it
+        record(out.latency(), !error);
+        if (error)
+            job->done.set_exception(error);
+        else
+            job->done.set_value(move(out));
+    });
+    return result;
+}
+
+void CodecService::record(double seconds, bool ok) {
+    histogram[bucket(seconds)].fetch_add(1, memory_order_relaxed);
+    if (!ok)
+        failed.fetch_add(1, memory_order_relaxed);
+    uint64_t nanos = (uint64_t)(seconds * 1e9);
+    totalNanos.fetch_add(nanos, memory_order_relaxed);
+    uint64_t seen = maxNanos.load(memory_order_relaxed);
+    while (nanos > seen && !maxNanos.compare_exchange_weak(seen, nanos, memory_order_relaxed))
+        ;
+}
+
+CodecService::Stats CodecService::stats() const {
+    Stats s = {};
+    uint64_t counts[BUCKETS];
+    for (int b = 0; b < BUCKETS; b++) {
+        counts[b] = histogram[b].load(memory_order_relaxed);
+        s.jobs += counts[b];
+    }
+    s.failed = failed.load(memory_order_relaxed);
+    s.max = maxNanos.load(memory_order_relaxed) / 1e9;
+    if (s.jobs == 0)
+        return s;
+    s.mean = totalNanos.load(memory_order_relaxed) / 1e9 / s.jobs;
+
+    // each percentile is the middle of the bucket holding that rank, but never past the max
+    double *targets[] = {&s.p50, &s.p99, &s.p999};
+    double fractions[] = {0.50, 0.99, 0.999};
+    for (int k = 0; k < 3; k++) {
+        uint64_t rank = (uint64_t)ceil(fractions[k] * s.jobs);
+        uint64_t seen = 0;
+        int b = 0;
+        while (b < BUCKETS - 1 && (seen += counts[b]) < rank)
+            b++;
+        *targets[k] = min(bucketSeconds(b), s.max);
+    }
+    return s;
+}
+
+void CodecService::resetStats() {
+    for (int b = 0; b < BUCKETS; b++)
+        histogram[b].store(0);
+    failed.store(0);
+    totalNanos.store(0);
+    maxNanos.store(0);
+}
+
+int CodecService::bucket(double seconds) {
+    double micros = seconds * 1e6;
+    if (micros <= 1)
+        return 0;
+    int b = (int)(log2(micros) * SUB_BUCKETS);
+    return b < BUCKETS ? b : BUCKETS - 1;
+}
+
+double CodecService::bucketSeconds(int b) {
+    return exp2((b + 0.5) / SUB_BUCKETS) / 1e6;
+}
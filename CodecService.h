@@ -0,0 +1,136 @@
+/**
+ * @file CodecService.h - In-process compress/decompress jobs run on a work-stealing pool.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string>
+#include "Huffman.h"
+#include "WorkStealingPool.h"
+
+/**
+ * @class CodecService - codes many unrelated payloads in parallel.
+ *
+ * Each job codes one payload with a shared model (Huffman::Shared), which the job holds
+ * until it is done, so callers may drop or replace their models at any time. A compressed
+ * payload is a single MessageBatch record (varint length, then the codes), so it carries
+ * its own length but not its model: decompress it with an equivalent one.
+ *
+ * Jobs run on a WorkStealingPool, so a large payload ties up one worker while the others
+ * keep taking the small ones. Every job reports how long it waited and how long it ran,
+ * and the service keeps a histogram of job latencies (submission to completion) for
+ * percentiles. All methods may be called from any thread.
+ */
+class CodecService {
+public:
+    /**
+     * The output of one job.
+     */
+    struct Result {
+        std::string data;     // the compressed record, or the decompressed payload
+        double queueSeconds;  // from submission until a worker started the job
+        double runSeconds;    // coding time
+
+        double latency() const {
+            return queueSeconds + runSeconds;
+        }
+    };
+
+    /**
+     * Latency figures, in seconds, over every job finished since the last resetStats().
+     * Percentiles are accurate to within 5%.
+     */
+    struct Stats {
+        uint64_t jobs;    // jobs finished, including failed ones
+        uint64_t failed;  // jobs whose future holds an exception
+        double mean;
+        double p50;
+        double p99;
+        double p999;
+        double max;
+    };
+
+    /**
+     * @param threads  number of workers; 0 for one per hardware thread
+     */
+    explicit CodecService(int threads = 0);
+
+    /**
+     * Finish every job already submitted.
+     */
+    ~CodecService() = default;
+
+    // big 5 (owns a thread pool, so neither copying nor moving is allowed)
+    CodecService(const CodecService& other) = delete;
+    CodecService(CodecService&& temp) = delete;
+    CodecService& operator=(const CodecService& other) = delete;
+    CodecService& operator=(CodecService&& temp) = delete;
+
+    /**
+     * Queue a payload to be compressed.
+     *
+     * @param model    codes to use; must be able to code every character of payload
+     * @param payload  the text to compress
+     * @return         the compressed record; it throws invalid_argument if the model
+     *                 cannot code the payload
+     * @throws invalid_argument  right away if model is null
+     */
+    std::future<Result> compress(Huffman::Shared model, std::string payload);
+
+    /**
+     * Queue a compressed record to be decompressed.
+     *
+     * @param model   codes the record was compressed with (or equivalent ones)
+     * @param record  a record from compress()
+     * @return        the payload; it throws invalid_argument if the record is malformed
+     * @throws invalid_argument  right away if model is null
+     */
+    std::future<Result> decompress(Huffman::Shared model, std::string record);
+
+    /**
+     * Number of jobs submitted that have not started yet.
+     */
+    size_t queueDepth() const {
+        return pool.queueDepth();
+    }
+
+    /**
+     * Number of worker threads.
+     */
+    int threads() const {
+        return pool.threads();
+    }
+
+    Stats stats() const;
+    void resetStats();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    /*
+     * Latency histogram: bucket b holds latencies of about 2^(b / SUB_BUCKETS) microseconds,
+     * so neighbouring buckets differ by 9% and the top one is over an hour.
+     */
+    static const int SUB_BUCKETS = 8;
+    static const int BUCKETS = 32 * SUB_BUCKETS;
+
+    std::atomic<uint64_t> histogram[BUCKETS];
+    std::atomic<uint64_t> failed;
+    std::atomic<uint64_t> totalNanos;
+    std::atomic<uint64_t> maxNanos;
+
+    WorkStealingPool pool;  // last, so the workers stop before the counters go away
+
+    template <typename Work>
+    std::future<Result> submit(Huffman::Shared model, std::string input, Work work);
+
+    void record(double seconds, bool ok);
+    static int bucket(double seconds);
+    static double bucketSeconds(int b);
+};
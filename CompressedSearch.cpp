@@ -0,0 +1,260 @@
+/**
+ * @file CompressedSearch.cpp - Find text in a Huffman-coded stream without decoding all of it.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "CompressedSearch.h"
+using namespace std;
+
+CompressedSearch::CompressedSearch(const Huffman& model, const BitStreamF& coded, const CheckpointIndex& index)
+        : model(model), coded(coded), index(index) {
+}
+
+uint64_t CompressedSearch::find(const string& pattern, uint64_t from) const {
+    uint64_t found = npos;
+    scan(pattern, from, [&](uint64_t offset) {
+        found = offset;
+        return false;
+    });
+    return found;
+}
+
+vector<uint64_t> CompressedSearch::findAll(const string& pattern, size_t limit) const {
+    vector<uint64_t> offsets;
+    if (limit == 0)
+        return offsets;
+    scan(pattern, 0, [&](uint64_t offset) {
+        offsets.push_back(offset);
+        return offsets.size() < limit;
+    });
+    return offsets;
+}
+
+uint64_t CompressedSearch::count(const string& pattern) const {
+    uint64_t n = 0;
+    scan(pattern, 0, [&](uint64_t) {
+        n++;
+        return true;
+    });
+    return n;
+}
+
+bool CompressedSearch::encodePattern(const string& pattern, Codes& codes) const {
+    const CodeTable& table = model.codeTable();
+    for (char c: pattern)
+        if (table.codeLength((unsigned char)c) == 0)
+            return false;
+    size_t bytes = model.encodedBound(pattern.size());
+    codes.words.assign((bytes + 7) / 8 + 1, 0);
+    codes.bitCount = model.encode((const uint8_t *)pattern.data(), pattern.size(),
+                                  (uint8_t *)codes.words.data(), codes.words.size() * 8);
+    return true;
+}
+
+uint64_t CompressedSearch::Codes::bitsAt(uint64_t pos, int n) const {
+    size_t i = (size_t)(pos / 64), shift = (size_t)(pos % 64);
+    uint64_t w = i < words.size() ? words[i] >> shift : 0;
+    if (shift != 0 && i + 1 < words.size())
+        w |= words[i + 1] << (64 - shift);
+    return n < 64 ? w & ((uint64_t(1) << n) - 1) : w;
+}
+
+bool CompressedSearch::matchesAt(const Codes& codes, uint64_t pos) const {
+    for (uint64_t done = 0; done < codes.bitCount; done += 64) {
+        int n = (int)min<uint64_t>(64, codes.bitCount - done);
+        if (coded.peekBitsAt(pos + done, n) != codes.bitsAt(done, n))
+            return false;
+    }
+    return true;
+}
+
+size_t CompressedSearch::checkpointBefore(uint64_t pos) const {
+    size_t lo = 0, hi = index.size();  // checkpoint 0 is at bit 0, so the answer is in [lo, hi)
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index.bitOffset(mid) <= pos)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+void CompressedSearch::seek(Cursor& cursor, uint64_t pos) const {
+    size_t nearest = checkpointBefore(pos);
+    if (index.bitOffset(nearest) > cursor.bit) {
+        cursor.bit = index.bitOffset(nearest);
+        cursor.text = (uint64_t)nearest * index.interval();
+    }
+    const CodeTable& table = model.codeTable();
+    int maxLength = table.maxCodeLength();
+    while (cursor.bit < pos) {
+        // decode from one 64-bit window for as long as it surely holds the next whole code
+        uint64_t window = coded.peekBitsAt(cursor.bit, 64);
+        int left = 64;
+        do {
+            uint8_t c;
+            int length = table.decodeOne(window, c);
+            if (length == 0)
+                throw invalid_argument("Code doesn't work");
+            window >>= length;
+            left -= length;
+            cursor.bit += length;
+            cursor.text++;
+        } while (cursor.bit < pos && left >= maxLength);
+    }
+}
+
+template <typename Visit>
+void CompressedSearch::scan(const string& pattern, uint64_t from, Visit visit) const {
+    if (pattern.empty())
+        throw invalid_argument("cannot search for an empty pattern");
+    Codes codes;
+    if (!encodePattern(pattern, codes) || index.size() == 0 || from >= index.textLength())
+        return;
+    uint64_t bitCount = coded.size();
+    if (codes.bitCount > bitCount)
+        return;
+    size_t checkpoint = (size_t)(from / index.interval());
+    Cursor cursor;
+    cursor.bit = index.bitOffset(checkpoint);
+    cursor.text = (uint64_t)checkpoint * index.interval();
+
+    // a hit is an occurrence if it starts on a code boundary (and at or after from)
+    auto check = [&](uint64_t pos) {
+        if (!matchesAt(codes, pos))
+            return true;
+        seek(cursor, pos);
+        if (cursor.bit != pos || cursor.text < from)
+            return true;
+        if (cursor.text + pattern.size() > index.textLength())
+            throw invalid_argument("coded stream does not match its index");
+        return visit(cursor.text);
+    };
+    if (codes.bitCount >= MIN_FILTER_BITS)
+        filter(codes, cursor.bit, check);
+    else if (codes.bitCount >= MIN_SLIDE_BITS)
+        slide(codes, cursor.bit, check);
+    else
+        decodeAll(pattern, cursor, from, visit);
+}
+
+/*
+ * A pattern starting bit a into a byte (a = 1..7) fills the rest of that byte, and whole
+ * bytes from its bit 8-a on (from bit 0 if a = 0). Those whole bytes are searched for with
+ * memmem() over the packed stream, one key per a; the hits from all eight keys are merged
+ * into bit order, a window of the stream at a time.
+ */
+template <typename Check>
+void CompressedSearch::filter(const Codes& codes, uint64_t start, Check check) const {
+    uint64_t bitCount = coded.size();
+    uint64_t last = bitCount - codes.bitCount;  // last bit a match could start at
+    uint64_t totalBytes = (bitCount + 7) / 8;
+
+    uint8_t keys[8][MAX_KEY];
+    size_t keyLength[8];
+    for (int a = 0; a < 8; a++) {
+        uint64_t skip = (8 - a) % 8;
+        keyLength[a] = (size_t)min<uint64_t>((codes.bitCount - skip) / 8, (uint64_t)MAX_KEY);
+        for (size_t k = 0; k < keyLength[a]; k++)
+            keys[a][k] = (uint8_t)codes.bitsAt(skip + 8 * k, 8);
+    }
+
+    vector<uint8_t> window(WINDOW + MAX_KEY + 8);
+    vector<uint64_t> hits;
+    for (uint64_t first = start / 8; first < totalBytes && first * 8 <= last; first += WINDOW) {
+        // bytes [first, end) of the stream; keys starting before first + WINDOW belong to this window
+        uint64_t end = min<uint64_t>(first + WINDOW + MAX_KEY, totalBytes);
+        size_t n = (size_t)(end - first);
+        for (size_t i = 0; i < n; i += 8) {
+            uint64_t w = coded.peekBitsAt(8 * (first + i), 64);
+            memcpy(&window[i], &w, 8);
+        }
+
+        hits.clear();
+        for (int a = 0; a < 8; a++) {
+            const uint8_t *base = window.data();
+            const uint8_t *p = base;
+            const uint8_t *stop = base + n;
+            while (p < stop) {
+                const uint8_t *hit = (const uint8_t *)memmem(p, stop - p, keys[a], keyLength[a]);
+                if (hit == nullptr || (uint64_t)(hit - base) >= WINDOW)
+                    break;
+                uint64_t byte = first + (hit - base);
+                p = hit + 1;
+                if (a != 0 && byte == 0)
+                    continue;
+                uint64_t pos = a == 0 ? 8 * byte : 8 * (byte - 1) + a;
+                if (pos >= start && pos <= last)
+                    hits.push_back(pos);
+            }
+        }
+        sort(hits.begin(), hits.end());
+        for (uint64_t pos: hits)
+            if (!check(pos))
+                return;
+    }
+}
+
+/*
+ * Short patterns are too common in the coded bits to be worth filtering, so each bit
+ * position is compared in turn (32 of them per 64-bit read).
+ */
+template <typename Check>
+void CompressedSearch::slide(const Codes& codes, uint64_t start, Check check) const {
+    uint64_t last = coded.size() - codes.bitCount;
+    int length = (int)codes.bitCount;
+    uint64_t mask = (uint64_t(1) << length) - 1;
+    uint64_t want = codes.bitsAt(0, length);
+    for (uint64_t base = start; base <= last; base += 32) {
+        uint64_t window = coded.peekBitsAt(base, 64);
+        int span = (int)min<uint64_t>(32, last - base + 1);
+        for (int s = 0; s < span; s++)
+            if (((window >> s) & mask) == want && !check(base + s))
+                return;
+    }
+}
+
+/*
+ * The codes of very short patterns turn up at so many bit positions that checking each
+ * one would cost more than just decoding everything, so that is what happens.
+ */
+template <typename Visit>
+void CompressedSearch::decodeAll(const string& pattern, Cursor cursor, uint64_t from, Visit visit) const {
+    const CodeTable& table = model.codeTable();
+    int maxLength = table.maxCodeLength();
+    uint64_t length = index.textLength();
+    size_t keep = pattern.size() - 1;  // an occurrence may start in the last keep characters
+    string text;
+    uint64_t textStart = cursor.text;  // offset of text[0]
+    while (cursor.text < length) {
+        while (cursor.text < length && text.size() < CHUNK) {
+            uint64_t window = coded.peekBitsAt(cursor.bit, 64);
+            int left = 64;
+            do {
+                uint8_t c;
+                int codeLength = table.decodeOne(window, c);
+                if (codeLength == 0)
+                    throw invalid_argument("Code doesn't work");
+                window >>= codeLength;
+                left -= codeLength;
+                cursor.bit += codeLength;
+                cursor.text++;
+                text += (char)c;
+            } while (cursor.text < length && left >= maxLength);
+        }
+        if (cursor.bit > coded.size())
+            throw invalid_argument("coded stream does not match its index");
+
+        for (size_t i = text.find(pattern); i != string::npos; i = text.find(pattern, i + 1))
+            if (textStart + i >= from && !visit(textStart + i))
+                return;
+        size_t drop = text.size() > keep ? text.size() - keep : 0;
+        text.erase(0, drop);
+        textStart += drop;
+    }
+}
@@ -0,0 +1,175 @@
+/**
+ * @file CompressedSearch.h - Find text in a Huffman-coded stream without decoding all of it.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BitStreamF.h"
+#include "CheckpointIndex.h"
+#include "Huffman.h"
+
+/**
+ * @class CompressedSearch - searches coded text for a pattern by looking for the pattern's codes.
+ *
+ * The pattern is encoded with the stream's own codes and the coded bits are scanned for that
+ * bit sequence at every bit position. A hit is only an occurrence if it starts on a code
+ * boundary (otherwise it is the tail of one code run into the next), which is checked by
+ * decoding from the checkpoint before the hit, or from the previous hit if that is closer.
+ * Decoding never goes backwards, so a search decodes at most the whole stream once, and
+ * far less when hits are rare: long patterns and rare characters mostly cost only the scan
+ * of the coded bits, which are smaller than the text.
+ *
+ * Occurrences may overlap ("aa" occurs twice in "aaa"). A pattern with a character that
+ * has no code cannot occur. The stream, index and model must outlive this object, and
+ * since it has no mutable state, one object may be searched from several threads.
+ */
+class CompressedSearch {
+public:
+    static const uint64_t npos = UINT64_MAX;
+
+    /**
+     * @param model  the codes the stream was encoded with
+     * @param coded  the whole bit stream encode() filled in along with index
+     * @param index  the checkpoint index encode() filled in
+     */
+    CompressedSearch(const Huffman& model, const BitStreamF& coded, const CheckpointIndex& index);
+
+    /**
+     * Offset in the text of the first occurrence of pattern at or after from.
+     *
+     * @return  npos if there is none
+     * @throws invalid_argument  if pattern is empty, or coded does not match index
+     */
+    uint64_t find(const std::string& pattern, uint64_t from = 0) const;
+
+    /**
+     * Offsets in the text of the occurrences of pattern, in order.
+     *
+     * @param limit  stop after this many
+     * @throws invalid_argument  if pattern is empty, or coded does not match index
+     */
+    std::vector<uint64_t> findAll(const std::string& pattern, size_t limit = SIZE_MAX) const;
+
+    /**
+     * Number of occurrences of pattern in the text.
+     *
+     * @throws invalid_argument  if pattern is empty, or coded does not match index
+     */
+    uint64_t count(const std::string& pattern) const;
+
+    /**
+     * Number of times a character occurs in the text.
+     */
+    uint64_t count(unsigned char c) const {
+        return count(std::string(1, (char)c));
+    }
+
+private:
+    const Huffman& model;
+    const BitStreamF& coded;
+    const CheckpointIndex& index;
+
+    /**
+     * The pattern's codes, packed as by BitStreamF::toBytes() into 64-bit words.
+     */
+    struct Codes {
+        std::vector<uint64_t> words;
+        uint64_t bitCount;
+
+        /**
+         * The n (0..64) bits starting at bit pos, zeros past the end.
+         */
+        uint64_t bitsAt(uint64_t pos, int n) const;
+    };
+
+    /**
+     * A place in the stream known to be on a code boundary: character text starts at bit.
+     */
+    struct Cursor {
+        uint64_t bit;
+        uint64_t text;
+    };
+
+    /**
+     * Patterns with at least this many bits of codes are searched for a byte at a time;
+     * that leaves at least two whole bytes to look for whatever bit the pattern starts at.
+     */
+    static const uint64_t MIN_FILTER_BITS = 7 + 2 * 8;
+
+    /**
+     * Shorter patterns (a character or two with short codes) turn up at so many bit
+     * positions that it is cheaper to decode everything than to check each one.
+     */
+    static const uint64_t MIN_SLIDE_BITS = 12;
+
+    /**
+     * Characters decoded at a time when decoding everything.
+     */
+    static const size_t CHUNK = 64 * 1024;
+
+    /**
+     * Most whole bytes of a pattern looked for in the byte search.
+     */
+    static const size_t MAX_KEY = 8;
+
+    /**
+     * Bytes of the stream searched at a time.
+     */
+    static const size_t WINDOW = 64 * 1024;
+
+    /**
+     * Encode pattern with the model.
+     *
+     * @return  false if pattern has a character without a code
+     */
+    bool encodePattern(const std::string& pattern, Codes& codes) const;
+
+    /**
+     * Call visit(offset) with the text offset of each occurrence of pattern that starts at
+     * or after text offset from, in order, until visit returns false.
+     */
+    template <typename Visit>
+    void scan(const std::string& pattern, uint64_t from, Visit visit) const;
+
+    /**
+     * Call check(pos), in order, for each bit pos from start on where the codes might
+     * start (at least the whole bytes match), until check returns false.
+     */
+    template <typename Check>
+    void filter(const Codes& codes, uint64_t start, Check check) const;
+
+    /**
+     * Call check(pos), in order, for each bit pos from start on where the codes start,
+     * until check returns false. Only for codes of at most 32 bits.
+     */
+    template <typename Check>
+    void slide(const Codes& codes, uint64_t start, Check check) const;
+
+    /**
+     * Call visit(offset), in order, for each occurrence at or after text offset from found
+     * by decoding everything from cursor on, until visit returns false.
+     */
+    template <typename Visit>
+    void decodeAll(const std::string& pattern, Cursor cursor, uint64_t from, Visit visit) const;
+
+    /**
+     * Decode from cursor (or a later checkpoint) until it reaches or passes bit pos.
+     * @throws invalid_argument  if the stream has bits that are not a code
+     */
+    void seek(Cursor& cursor, uint64_t pos) const;
+
+    /**
+     * Whether all of codes appear at bit pos of the stream.
+     */
+    bool matchesAt(const Codes& codes, uint64_t pos) const;
+
+    /**
+     * Index of the last checkpoint at or before bit pos.
+     */
+    size_t checkpointBefore(uint64_t pos) const;
+};
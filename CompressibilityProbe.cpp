@@ -0,0 +1,90 @@
+/**
+ * @file CompressibilityProbe.cpp - Predict the coded size of some text without coding it.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <vector>
+#include "CompressibilityProbe.h"
+using namespace std;
+
+uint64_t CompressibilityProbe::histogram(const uint8_t *data, size_t n, size_t sampleSize,
+                                         uint64_t histogram[]) {
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        histogram[c] = 0;
+    if (sampleSize == 0 || sampleSize >= n) {
+        for (size_t i = 0; i < n; i++)
+            histogram[data[i]]++;
+        return n;
+    }
+
+    // chunks spread evenly so the sample sees the whole input, not just its start; no more
+    // of them than fit side by side, so they never overlap and no character counts twice
+    size_t chunks = (sampleSize + SAMPLE_CHUNK - 1) / SAMPLE_CHUNK;
+    chunks = max(min(chunks, n / SAMPLE_CHUNK), (size_t)1);
+    size_t stride = n / chunks;
+    uint64_t counted = 0;
+    for (size_t k = 0; k < chunks; k++) {
+        size_t start = k * stride;
+        size_t end = start + SAMPLE_CHUNK < n ? start + SAMPLE_CHUNK : n;
+        for (size_t i = start; i < end; i++)
+            histogram[data[i]]++;
+        counted += end - start;
+    }
+    return counted;
+}
+
+uint64_t CompressibilityProbe::huffmanBits(const uint64_t histogram[], const Huffman& model) {
+    uint64_t bits = 0;
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++) {
+        if (histogram[c] == 0)
+            continue;
+        int length = model.codeTable().codeLength((uint8_t)c);
+        if (length == 0)
+            return UINT64_MAX;
+        bits += histogram[c] * length;
+    }
+    return bits;
+}
+
+uint64_t CompressibilityProbe::huffmanBits(const uint64_t histogram[]) {
+    // every merge while building a Huffman tree adds one bit to each character under it,
+    // so the coded size is the sum of the merged weights and the tree itself isn't needed
+    priority_queue<uint64_t, vector<uint64_t>, greater<uint64_t>> weights;
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        if (histogram[c] != 0)
+            weights.push(histogram[c]);
+    if (weights.size() == 1)
+        return weights.top();  // a lone character still takes a one-bit code
+    uint64_t bits = 0;
+    while (weights.size() > 1) {
+        uint64_t a = weights.top();
+        weights.pop();
+        uint64_t b = weights.top();
+        weights.pop();
+        bits += a + b;
+        weights.push(a + b);
+    }
+    return bits;
+}
+
+double CompressibilityProbe::shannonBits(const uint64_t histogram[]) {
+    double total = 0;
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        total += (double)histogram[c];
+    double bits = 0;
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        if (histogram[c] != 0)
+            bits += (double)histogram[c] * log2(total / (double)histogram[c]);
+    return bits;
+}
+
+double CompressibilityProbe::savings(uint64_t codedBits, uint64_t characters) {
+    if (characters == 0)
+        return 0;
+    return 1.0 - (double)codedBits / (8.0 * (double)characters);
+}
@@ -0,0 +1,61 @@
+/**
+ * @file CompressibilityProbe.h - Predict the coded size of some text without coding it.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "Huffman.h"
+
+/**
+ * @class CompressibilityProbe - histogram-only estimates of how well text will compress.
+ *
+ * The Huffman size is exact for the characters counted: the sum over the histogram of
+ * count times code length. The Shannon bound is the entropy of the histogram, which no
+ * code for these counts can beat. Counting can be limited to a sample of a large input,
+ * in which case the results are for the sample.
+ */
+class CompressibilityProbe {
+public:
+    static const size_t DEFAULT_SAMPLE_SIZE = 16 * 1024;
+    static const size_t SAMPLE_CHUNK = 512;
+
+    /**
+     * Count the characters of data, or of an evenly spread sample of it.
+     *
+     * @param data        text to count
+     * @param n           number of characters in data
+     * @param sampleSize  characters to count, taken as SAMPLE_CHUNK-sized runs spread
+     *                    evenly over data (rounded up to whole runs); 0 means count all of data
+     * @param histogram   receives the count of each character 0..MAX_CHAR
+     * @return            number of characters counted, never more than n
+     */
+    static uint64_t histogram(const uint8_t *data, size_t n, size_t sampleSize, uint64_t histogram[]);
+
+    /**
+     * Exact number of bits model would code the counted characters into.
+     *
+     * @return  UINT64_MAX if the histogram has a character the model has no code for
+     */
+    static uint64_t huffmanBits(const uint64_t histogram[], const Huffman& model);
+
+    /**
+     * Exact number of bits the counted characters would take with their own Huffman codes,
+     * i.e., the best any Huffman code can do for them (ignoring the Bits::MAX_BITS limit,
+     * which only very skewed counts reach). Cheap enough to call for every block.
+     */
+    static uint64_t huffmanBits(const uint64_t histogram[]);
+
+    /**
+     * Shannon entropy bound in bits for the counted characters.
+     */
+    static double shannonBits(const uint64_t histogram[]);
+
+    /**
+     * Fraction of space that coding saves over storing the text: 1 - codedBits / (8 * characters).
+     * Zero or negative means coding would not save anything.
+     */
+    static double savings(uint64_t codedBits, uint64_t characters);
+};
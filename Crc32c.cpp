@@ -0,0 +1,94 @@
+/**
+ * @file Crc32c.cpp - CRC-32C (Castagnoli) checksums.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <cstring>
+#include "Crc32c.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#endif
+using namespace std;
+
+namespace {
+
+const uint32_t POLYNOMIAL = 0x82f63b78;  // reversed Castagnoli polynomial
+
+/*
+ * table[k][b] is the CRC of byte b followed by k zero bytes, for slicing-by-8.
+ */
+struct Tables {
+    uint32_t table[8][256];
+
+    Tables() {
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t crc = b;
+            for (int i = 0; i < 8; i++)
+                crc = (crc >> 1) ^ ((crc & 1u) ? POLYNOMIAL : 0);
+            table[0][b] = crc;
+        }
+        for (uint32_t b = 0; b < 256; b++)
+            for (int k = 1; k < 8; k++)
+                table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xff];
+    }
+};
+
+const Tables& tables() {
+    static const Tables t;
+    return t;
+}
+
+}
+
+uint32_t Crc32c::extend(uint32_t crc, const uint8_t *data, size_t n) {
+    static const bool useHardware = hardware();
+    return useHardware ? extendHardware(crc, data, n) : extendSoftware(crc, data, n);
+}
+
+bool Crc32c::hardware() {
+#if defined(CRC32C_X86) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return false;
+#endif
+}
+
+uint32_t Crc32c::extendSoftware(uint32_t crc, const uint8_t *data, size_t n) {
+    const uint32_t (*t)[256] = tables().table;
+    crc = ~crc;
+    for (; n >= 8; n -= 8, data += 8) {
+        uint32_t low = crc ^ ((uint32_t)data[0] | (uint32_t)data[1] << 8 |
+                              (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24);
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+              t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    }
+    for (; n > 0; n--, data++)
+        crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xff];
+    return ~crc;
+}
+
+#if defined(CRC32C_X86) && (defined(__GNUC__) || defined(__clang__))
+__attribute__((target("sse4.2")))
+uint32_t Crc32c::extendHardware(uint32_t crc, const uint8_t *data, size_t n) {
+#if defined(__x86_64__)
+    uint64_t c = ~crc;
+    for (; n >= 8; n -= 8, data += 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        c = _mm_crc32_u64(c, word);
+    }
+    uint32_t c32 = (uint32_t)c;
+#else
+    uint32_t c32 = ~crc;
+#endif
+    for (; n > 0; n--, data++)
+        c32 = _mm_crc32_u8(c32, *data);
+    return ~c32;
+}
+#else
+uint32_t Crc32c::extendHardware(uint32_t crc, const uint8_t *data, size_t n) {
+    return extendSoftware(crc, data, n);
+}
+#endif
@@ -0,0 +1,39 @@
+/**
+ * @file Crc32c.h - CRC-32C (Castagnoli) checksums.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class Crc32c - CRC-32C, as used by iSCSI, ext4 and SSE4.2's crc32 instruction.
+ *
+ * On x86 processors with SSE4.2 the crc32 instruction does 8 bytes at a time; everywhere
+ * else a slicing-by-8 table does the same in software. The choice is made once, at run time.
+ */
+class Crc32c {
+public:
+    /**
+     * CRC of a whole buffer.
+     */
+    static uint32_t compute(const uint8_t *data, size_t n) {
+        return extend(0, data, n);
+    }
+
+    /**
+     * Continue a CRC over more data: extend(compute(a), b) == compute(a followed by b).
+     */
+    static uint32_t extend(uint32_t crc, const uint8_t *data, size_t n);
+
+    /**
+     * Whether the SSE4.2 instruction is being used.
+     */
+    static bool hardware();
+
+private:
+    static uint32_t extendSoftware(uint32_t crc, const uint8_t *data, size_t n);
+    static uint32_t extendHardware(uint32_t crc, const uint8_t *data, size_t n);
+};
@@ -0,0 +1,90 @@
+/**
+ * @file EntropyCoder.h - Common interface of the buffer-to-buffer entropy coders.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include "CompressibilityProbe.h"
+#include "Huffman.h"
+
+/**
+ * @class EntropyCoder - codes a buffer of characters with a fixed model, and back.
+ *
+ * BlockCodec picks a coder for each block by asking each one to predict its size from
+ * the block's histogram, so new coders can be added without changing the frame plumbing.
+ * Coders have no mutable state, so one object may be used from several threads.
+ */
+class EntropyCoder {
+public:
+    virtual ~EntropyCoder() = default;
+
+    /**
+     * Bits encode() would take for the counted characters (a close estimate is enough).
+     *
+     * @return  UINT64_MAX if there is a character this coder cannot code
+     */
+    virtual uint64_t predictBits(const uint64_t histogram[]) const = 0;
+
+    /**
+     * Largest number of bytes encode() can write for n characters.
+     */
+    virtual size_t encodedBound(size_t n) const = 0;
+
+    /**
+     * Code a buffer of characters into a caller-owned buffer.
+     *
+     * @return  exact number of bits written; (return+7)/8 bytes of dst were used
+     * @throws invalid_argument  if src has a character this coder cannot code
+     * @throws length_error      if dst is too small
+     */
+    virtual size_t encode(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const = 0;
+
+    /**
+     * Decode exactly n characters from bits written by encode().
+     *
+     * @param bitCount  the number of bits that encode() returned
+     * @throws invalid_argument  if the bits are not n characters' worth of this coder's codes
+     */
+    virtual void decode(const uint8_t *src, size_t bitCount, uint8_t *dst, size_t n) const = 0;
+};
+
+/**
+ * @class HuffmanCoder - a Huffman model seen as an EntropyCoder.
+ */
+class HuffmanCoder : public EntropyCoder {
+public:
+    /**
+     * @param model  the codes to use, must outlive this object
+     */
+    explicit HuffmanCoder(const Huffman& model) : model(model) {}
+
+    uint64_t predictBits(const uint64_t histogram[]) const override {
+        return CompressibilityProbe::huffmanBits(histogram, model);
+    }
+
+    size_t encodedBound(size_t n) const override {
+        return model.encodedBound(n);
+    }
+
+    size_t encode(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const override {
+        return model.encode(src, n, dst, cap);
+    }
+
+    void decode(const uint8_t *src, size_t bitCount, uint8_t *dst, size_t n) const override {
+        size_t decoded;
+        try {
+            decoded = model.decode(src, bitCount, dst, n);
+        } catch (const std::length_error&) {
+            decoded = n + 1;
+        }
+        if (decoded != n)
+            throw std::invalid_argument("codes do not match the length");
+    }
+
+private:
+    const Huffman& model;
+};
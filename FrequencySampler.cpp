@@ -0,0 +1,90 @@
+/**
+ * @file FrequencySampler.cpp - Count characters from blocks spread over a large input.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "FrequencySampler.h"
+using namespace std;
+
+FrequencySampler::FrequencySampler(double fraction, uint64_t maxBytes, size_t blockSize, uint64_t seed)
+        : fraction(fraction), maxBytes(maxBytes), blockSize(blockSize), seed(seed) {
+    if (!(fraction > 0 && fraction <= 1))
+        throw invalid_argument("sample fraction must be in (0, 1]");
+    if (maxBytes == 0 || blockSize == 0)
+        throw invalid_argument("sample budget and block size must be positive");
+}
+
+uint64_t FrequencySampler::budget(uint64_t inputSize) const {
+    uint64_t bytes = (uint64_t)ceil(fraction * (double)inputSize);
+    if (bytes > maxBytes)
+        bytes = maxBytes;
+    // whole blocks, at least one
+    uint64_t blocks = (bytes + blockSize - 1) / blockSize;
+    bytes = (blocks > 0 ? blocks : 1) * blockSize;
+    return bytes < inputSize ? bytes : inputSize;
+}
+
+bool FrequencySampler::seekable(istream& in) {
+    return in.tellg() != streampos(-1);
+}
+
+void FrequencySampler::reserve(uint64_t frequencies[]) {
+    for (int c = 0; c <= 255; c++)
+        if (frequencies[c] == 0)
+            frequencies[c] = 1;
+}
+
+uint64_t FrequencySampler::count(istream& in, uint64_t frequencies[]) const {
+    for (int c = 0; c <= 255; c++)
+        frequencies[c] = 0;
+    streampos start = in.tellg();
+    if (start == streampos(-1))
+        throw invalid_argument("cannot sample a stream that cannot seek");
+    in.seekg(0, ios::end);
+    streampos end = in.tellg();
+    if (!in || end < start) {
+        in.clear();
+        in.seekg(start);
+        throw invalid_argument("cannot sample a stream that cannot seek");
+    }
+    uint64_t size = (uint64_t)(end - start);
+
+    // one block from each of blocks equal stretches, or every block if the budget allows
+    uint64_t total = budget(size);
+    uint64_t blocks, stride;
+    if (total >= size) {
+        blocks = (size + blockSize - 1) / blockSize;
+        stride = blockSize;
+    } else {
+        blocks = total / blockSize;
+        stride = size / blocks;
+    }
+    mt19937_64 random(seed);
+    vector<char> buffer(blockSize);
+    uint64_t counted = 0;
+    for (uint64_t k = 0; k < blocks; k++) {
+        uint64_t offset = k * stride;
+        if (seed != 0 && stride > blockSize)
+            offset += random() % (stride - blockSize + 1);
+        in.seekg(start + (streamoff)offset);
+        in.read(buffer.data(), blockSize);
+        streamsize n = in.gcount();
+        if (n <= 0) {
+            // leave the stream where it was, as on success
+            in.clear();
+            in.seekg(start);
+            throw invalid_argument("cannot read the stream being sampled");
+        }
+        for (streamsize i = 0; i < n; i++)
+            frequencies[(unsigned char)buffer[i]]++;
+        counted += n;
+    }
+    in.clear();
+    in.seekg(start);
+    return counted;
+}
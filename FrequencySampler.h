@@ -0,0 +1,74 @@
+/**
+ * @file FrequencySampler.h - Count characters from blocks spread over a large input.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+
+/**
+ * @class FrequencySampler - character counts for a model, at a cost set by a budget.
+ *
+ * Reading a whole 20 GB file to count its characters costs as much as coding it. A sampler
+ * instead reads fixed-size blocks spread evenly over the input, seeking from one to the
+ * next, and stops at its budget: a fraction of the input, capped at a number of bytes. So
+ * the time to build a model depends on the budget, not on the size of the input.
+ *
+ * Characters that happen to miss the sample would have no code. reserve() gives each of
+ * them a count of one, which costs the sampled characters almost nothing (they are already
+ * counted in thousands) and makes any input encodable.
+ */
+class FrequencySampler {
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+    static const uint64_t DEFAULT_MAX_BYTES = 16 * 1024 * 1024;
+    static constexpr double DEFAULT_FRACTION = 0.01;
+
+    /**
+     * @param fraction   share of the input to read, in (0, 1]
+     * @param maxBytes   most bytes to read, however large the input
+     * @param blockSize  bytes read at each place sampled
+     * @param seed       0 to read each block from the start of its stretch of the input
+     *                   (the same blocks every time); otherwise each block starts at a
+     *                   random place in its stretch, chosen with this seed
+     * @throws invalid_argument  if fraction is not in (0, 1] or maxBytes or blockSize is 0
+     */
+    explicit FrequencySampler(double fraction = DEFAULT_FRACTION, uint64_t maxBytes = DEFAULT_MAX_BYTES,
+                              size_t blockSize = DEFAULT_BLOCK_SIZE, uint64_t seed = 0);
+
+    /**
+     * Count the characters of a sample of a stream, from its current position to its end.
+     * Inputs no bigger than the budget are counted in full.
+     *
+     * @param in           a stream that can seek; it is left at the position it started at
+     * @param frequencies  receives the count of each character 0..255
+     * @return             number of characters counted
+     * @throws invalid_argument  if in cannot seek or cannot be read (in is still left where
+     *                           it started, if it can seek at all)
+     */
+    uint64_t count(std::istream& in, uint64_t frequencies[]) const;
+
+    /**
+     * Give every character with a count of zero a count of one.
+     */
+    static void reserve(uint64_t frequencies[]);
+
+    /**
+     * Whether in can be sampled (it reports its position, so it can seek).
+     */
+    static bool seekable(std::istream& in);
+
+    /**
+     * Bytes count() reads from an input of the given size.
+     */
+    uint64_t budget(uint64_t inputSize) const;
+
+private:
+    double fraction;
+    uint64_t maxBytes;
+    size_t blockSize;
+    uint64_t seed;
+};
@@ -21,7 +21,9 @@
 #include "Huffman.h"
 #include "BinaryNode.h"
 #include "PQueueLL.h"
+#include "BitStreamF.h"
 #include <stdexcept>
+#include <vector>
 using namespace std;
 
 Huffman::Huffman(istream &sampleSource) : root(nullptr){
@@ -34,44 +36,174 @@ Huffman::Huffman(istream &sampleSource) : root(nullptr){
     sample(sampleSource);
 }
 
+Huffman::Huffman(const uint64_t frequencies[]) : root(nullptr) {
+    for(int i = 0; i <= MAX_CHAR; i++) {
+      samplecount[i] = frequencies[i];
+    }
+    buildCodeTree();
+    populateCodes(root, Bits());
+    buildTables();
+}
+
+Huffman::Huffman(istream &sampleSource, const FrequencySampler& sampler) : root(nullptr) {
+    sampler.count(sampleSource, samplecount);
+    FrequencySampler::reserve(samplecount);
+    buildCodeTree();
+    populateCodes(root, Bits());
+    buildTables();
+}
+
 Huffman::~Huffman() {
     clear();
 }
 void Huffman::encode(istream& source, BitStream& codedOutput) const {
-    int a = source.get();
-    while(a != EOF) {
-      Bits bits = codes[to_unsigned(a)];
-      codedOutput << bits;
-      a = source.get();
-    }
+    encode<BitStream>(source, codedOutput);
 }
 
 void Huffman::decode(BitStream& codedInput, ostream& out) const {
-    while(!codedInput.empty()) {
-      unsigned char c;
-      if(!translateCode(codedInput,c,false)) {
-        if(codedInput.empty()) {
-          throw invalid_argument("Bit stream early ending");
-        }
-        else {
-          throw invalid_argument("Code doesn't work");
+    decode<BitStream>(codedInput, out);
+}
+
+namespace {
+
+const size_t LENGTH_BYTES = 2;
+const size_t WORD_BYTES = sizeof(uint32_t);
+const size_t WINDOW_WORDS = 1024;
+
+/*
+ * The bits of a file written by BitStreamF::writeToFile(), read a window of 32-bit words
+ * at a time as decoding reaches them. File layout: the number of bits in the first word
+ * (the low-order ones) and in the last, then little-endian 32-bit words.
+ */
+class FileBits {
+public:
+    explicit FileBits(istream& in) : in(in), base(in.tellg()), windowStart(0) {
+        in.seekg(0, ios::end);
+        streamoff end = in.tellg();
+        unsigned char lengths[LENGTH_BYTES];
+        if (base < 0 || end - base < (streamoff)(sizeof(lengths) + WORD_BYTES) ||
+            !in.seekg(base) || !in.read((char *)lengths, sizeof(lengths)) || lengths[0] > 32 || lengths[1] > 32)
+            throw invalid_argument("not a saved bit stream");
+        fileWords = (size_t)((end - base - sizeof(lengths)) / WORD_BYTES);
+        // as BitStreamF loads it: a short first word is slid up against the second
+        head = fileWords == 1 ? 0 : 32 - lengths[0];
+        bits = fileWords == 1 ? lengths[1] : 32 * (fileWords - 1) + lengths[1] - head;
+    }
+
+    size_t size() const {
+        return bits;
+    }
+
+    /*
+     * As BitStreamF::peekBitsAt(), with bits past the end of the file reading as zeros.
+     */
+    uint64_t peekBitsAt(size_t pos, int n) {
+        size_t at = head + pos;
+        size_t word = at / 32;
+        int shift = at % 32;
+        if (window.empty() || word < windowStart || word + 3 > windowStart + window.size())
+            load(word);
+        const uint32_t *w = &window[word - windowStart];
+        uint64_t value = (w[0] | (uint64_t)w[1] << 32) >> shift;
+        if (shift != 0)
+            value |= (uint64_t)w[2] << (64 - shift);
+        return n == 64 ? value : value & ((uint64_t(1) << n) - 1);
+    }
+
+private:
+    istream& in;
+    streamoff base;
+    size_t fileWords, head, bits;
+    vector<uint32_t> window;
+    size_t windowStart;
+
+    void load(size_t word) {
+        window.assign(WINDOW_WORDS, 0);
+        windowStart = word;
+        if (word >= fileWords)
+            return;
+        size_t count = min(WINDOW_WORDS, fileWords - word);
+        vector<unsigned char> bytes(count * WORD_BYTES);
+        in.clear();
+        if (!in.seekg(base + (streamoff)(LENGTH_BYTES + word * WORD_BYTES)) || !in.read((char *)bytes.data(), bytes.size()))
+            throw invalid_argument("cannot read the bit stream");
+        for (size_t i = 0; i < bytes.size(); i++)
+            window[i / WORD_BYTES] |= uint32_t(bytes[i]) << (8 * (i % WORD_BYTES));
+        if (word == 0)
+            window[0] = (uint32_t)((uint64_t)window[0] << head);
+    }
+};
+
+}
+
+template <typename Source>
+void Huffman::decodeRangeFrom(Source& coded, const CheckpointIndex& index,
+                              uint64_t offset, size_t length, ostream& out) const {
+    if (offset > index.textLength())
+        throw out_of_range("offset past the end of the text");
+    if (length > index.textLength() - offset)
+        length = index.textLength() - offset;
+    if (length == 0)
+        return;
+
+    // decode (and throw away) from the checkpoint up to offset, then keep length characters
+    size_t checkpoint = offset / index.interval();
+    uint64_t pos = index.bitOffset(checkpoint);
+    uint64_t skip = offset - (uint64_t)checkpoint * index.interval();
+    size_t bitCount = coded.size();
+    char chunk[CHUNK_SIZE];
+    int n = 0;
+    for (uint64_t i = 0; i < skip + length; i++) {
+        uint8_t c;
+        size_t codeLength = table.decodeOne(coded.peekBitsAt(pos, 64), c);
+        if (codeLength == 0)
+            throw invalid_argument("Code doesn't work");
+        if (pos + codeLength > bitCount)
+            throw invalid_argument("Bit stream early ending");
+        pos += codeLength;
+        if (i < skip)
+            continue;
+        chunk[n++] = (char)c;
+        if (n == CHUNK_SIZE) {
+            out.write(chunk, n);
+            n = 0;
         }
-      }
-      out << c;
     }
+    out.write(chunk, n);
+}
+
+void Huffman::decodeRange(const BitStreamF& coded, const CheckpointIndex& index,
+                          uint64_t offset, size_t length, ostream& out) const {
+    decodeRangeFrom(coded, index, offset, length, out);
+}
+
+void Huffman::decodeRange(istream& coded, const CheckpointIndex& index,
+                          uint64_t offset, size_t length, ostream& out) const {
+    FileBits bits(coded);
+    decodeRangeFrom(bits, index, offset, length, out);
 }
 
 Bits Huffman::getCode(unsigned char c) const {
     return codes[c];
 }
 
-int Huffman::getFrequency(unsigned char c) const {
+uint64_t Huffman::getFrequency(unsigned char c) const {
     return samplecount[c];
 }
 
-Huffman::PQEntry::PQEntry(int freq, unsigned char c) : frequency(freq), codeTree(new CodeTree(c)) {}
+void Huffman::writeFrequencies(ostream& out) const {
+    out.write((const char*)samplecount, sizeof(samplecount));
+}
+
+void Huffman::readFrequencies(istream& in, uint64_t frequencies[]) {
+    if(!in.read((char*)frequencies, (MAX_CHAR+1) * sizeof(uint64_t))) {
+      throw invalid_argument("frequency table ended early");
+    }
+}
 
-Huffman::PQEntry::PQEntry(int combinedFrequency, CodeTree *lessFrequent, CodeTree *moreFrequent)
+Huffman::PQEntry::PQEntry(uint64_t freq, unsigned char c) : frequency(freq), codeTree(new CodeTree(c)) {}
+
+Huffman::PQEntry::PQEntry(uint64_t combinedFrequency, CodeTree *lessFrequent, CodeTree *moreFrequent)
   :frequency(combinedFrequency), codeTree(new CodeTree(moreFrequent, lessFrequent, '*')) {}
 
 bool Huffman::PQEntry::operator<(const PQEntry& rhs) const {
@@ -83,6 +215,14 @@ void Huffman::sample(std::istream &sampleSource) {
     collectFrequencies(sampleSource);
     buildCodeTree();
     populateCodes(root, Bits());
+    buildTables();
+}
+
+void Huffman::buildTables() {
+    table.build(codes);
+    // the pair table only beats encoding without AVX2
+    if (table.multiSymbol() && !CodeTable::vectorized())
+        pairs.build(table);
 }
 
 bool Huffman::translateCode(BitStream &code, unsigned char &c, bool mustUseItAll) const {
@@ -108,20 +248,59 @@ bool Huffman::translateCode(BitStream &code, unsigned char &c, bool mustUseItAll
 }
 
 void Huffman::collectFrequencies(std::istream &sampleSource) {
-    while(!sampleSource.eof()) {
-      char c;
-      sampleSource.get(c);
-      samplecount[(to_unsigned(c))]+=1;
+    char chunk[CHUNK_SIZE];
+    while(sampleSource.read(chunk, CHUNK_SIZE) || sampleSource.gcount() > 0) {
+      streamsize n = sampleSource.gcount();
+      for(streamsize i = 0; i < n; i++) {
+        samplecount[to_unsigned(chunk[i])]+=1;
+      }
     }
 }
 
 void Huffman::buildCodeTree() {
+    uint64_t weights[MAX_CHAR+1];
+    for(int i = 0; i <= MAX_CHAR; i++) {
+      weights[i] = samplecount[i];
+    }
+    for(;;) {
+      buildCodeTree(weights);
+      if(depth(root) <= Bits::MAX_BITS) {
+        return;
+      }
+      // too deep: flatten the distribution (keeping every character) and try again
+      clear();
+      for(int i = 0; i <= MAX_CHAR; i++) {
+        if(weights[i] != 0) {
+          weights[i] = weights[i] / 2 + 1;
+        }
+      }
+    }
+}
+
+int Huffman::depth(const CodeTree *node) {
+    if(node == nullptr || node->isLeaf()) {
+      return 0;
+    }
+    return 1 + max(depth(node->left), depth(node->right));
+}
+
+void Huffman::buildCodeTree(const uint64_t weights[]) {
     PQueueLL<PQEntry> pq;
+    int distinct = 0;
     for(unsigned int i = 0; i <= MAX_CHAR; i++) {
-      if(samplecount[i]!=0) {
-        pq.enqueue(PQEntry(samplecount[i],i));
+      if(weights[i]!=0) {
+        pq.enqueue(PQEntry(weights[i],i));
+        distinct++;
       }
     }
+    if(distinct == 0) {
+      throw invalid_argument("cannot build codes from an empty sample");
+    }
+    // a lone character still needs a one-bit code, so give it an unused sibling
+    if(distinct == 1) {
+      unsigned char only = pq.peek().codeTree->data;
+      pq.enqueue(PQEntry(0, (unsigned char)(only + 1)));
+    }
     while(!pq.empty()) {
       PQEntry tree = pq.peek();
       pq.dequeue();
@@ -7,13 +7,26 @@
 #pragma once
 #include <iostream>
 #include <fstream>
+#include <cstddef>
+#include <memory>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
 #include "adt/BitStream.h"
 #include "Bits.h"
 #include "BinaryNode.h"
+#include "CodeTable.h"
+#include "FrequencySampler.h"
+#include "CheckpointIndex.h"
+
+class BitStreamF;
 
 /**
  * @class Huffman - Huffman encoder/decoder.
  *
+ * Nothing in a Huffman object changes after construction, so all of its const methods may
+ * be called from any number of threads at once. To share one trained model between threads
+ * that come and go, hold it through a Huffman::Shared (see share()).
  */
 class Huffman {
 public:
@@ -28,6 +41,29 @@ public:
      */
     explicit Huffman(std::istream &sampleSource);
 
+    /**
+     * Construct a Huffman encoder/decoder from a previously collected frequency table.
+     *
+     * Two Huffman objects constructed from the same frequencies always produce the same codes,
+     * so a decoder can be rebuilt from a table saved with writeFrequencies().
+     * @param frequencies  observation count of each character 0..MAX_CHAR
+     * @pre                at least one frequency is non-zero
+     * @post               only characters with a non-zero frequency may be encoded
+     */
+    explicit Huffman(const uint64_t frequencies[]);
+
+    /**
+     * Construct a Huffman encoder/decoder from a sample of a large, seekable stream.
+     *
+     * Only the sampler's budget is read, so this costs the same for any size of input.
+     * @param sampleSource  the stream to sample; it is left where it was
+     * @param sampler       which parts of the stream to count
+     * @throws invalid_argument  if sampleSource cannot seek
+     * @post                every character may be encoded, seen in the sample or not
+     *                      (see FrequencySampler::reserve())
+     */
+    Huffman(std::istream &sampleSource, const FrequencySampler& sampler);
+
     // big 5
     ~Huffman();
     Huffman() = delete;
@@ -36,6 +72,19 @@ public:
     Huffman& operator=(const Huffman& other) = delete;
     Huffman& operator=(Huffman&& temp) = delete;
 
+    /**
+     * A reference-counted, immutable model: safe to encode and decode with from several
+     * threads at once, and freed when the last holder lets go.
+     */
+    typedef std::shared_ptr<const Huffman> Shared;
+
+    /**
+     * Build a model to be shared, from a frequency table (as Huffman(const uint64_t[])).
+     */
+    static Shared share(const uint64_t frequencies[]) {
+        return std::make_shared<const Huffman>(frequencies);
+    }
+
     /**
      * Encode the given source text.
      *
@@ -57,6 +106,124 @@ public:
      */
     void decode(BitStream& codedInput, std::ostream& out) const;
 
+    /**
+     * Same as encode(std::istream&, BitStream&) but for a concrete stream type (e.g., BitStreamF),
+     * so that the per-character putBits() calls are bound at compile time instead of virtually.
+     */
+    template <typename Stream>
+    void encode(std::istream& source, Stream& codedOutput) const {
+        encodeIndexed(source, codedOutput, nullptr);
+    }
+
+    /**
+     * Encode the given source text and also fill in a checkpoint index for decodeRange().
+     *
+     * @param source       the text to be encoded into Huffman codes
+     * @param codedOutput  a bit stream to hold the Huffman codes
+     * @param index        cleared, then given a checkpoint every index.interval() characters;
+     *                     offsets count from the first bit this call puts into codedOutput
+     * @throws invalid_argument  if there are characters in the source that were not in the sample
+     */
+    template <typename Stream>
+    void encode(std::istream& source, Stream& codedOutput, CheckpointIndex& index) const {
+        index.clear();
+        encodeIndexed(source, codedOutput, &index);
+    }
+
+    /**
+     * Same as decode(BitStream&, std::ostream&) but for a concrete stream type (e.g., BitStreamF),
+     * so that the per-character peekBits()/consumeBits() calls are bound at compile time.
+     */
+    template <typename Stream>
+    void decode(Stream& codedInput, std::ostream& out) const;
+
+    /**
+     * Encode a buffer of characters straight into a caller-owned buffer, without allocating.
+     *
+     * The bits are packed the same way as BitStreamF::toBytes().
+     * @param src  the text to be encoded
+     * @param n    number of characters in src
+     * @param dst  receives the packed codes
+     * @param cap  bytes available in dst (encodedBound(n) is always enough)
+     * @return     exact number of bits written; (return+7)/8 bytes of dst were used
+     * @throws invalid_argument  if there are characters in src that were not in the sample
+     * @throws length_error      if dst is too small
+     */
+    size_t encode(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const {
+        if (!pairs.empty())
+            return pairs.encode(table, src, n, dst, cap);
+        return table.encode(src, n, dst, cap);
+    }
+
+    /**
+     * Decode a buffer of packed codes straight into a caller-owned buffer, without allocating.
+     *
+     * @param src       packed codes as written by the buffer encode()
+     * @param bitCount  the number of bits that encode() returned
+     * @param dst       receives the original text
+     * @param cap       bytes available in dst
+     * @return          exact number of characters written
+     * @throws invalid_argument  if the bits are not a sequence of this object's codes
+     * @throws length_error      if dst is too small
+     */
+    size_t decode(const uint8_t *src, size_t bitCount, uint8_t *dst, size_t cap) const {
+        return table.decode(src, bitCount, dst, cap);
+    }
+
+    /**
+     * Decode a known number of characters from the front of a buffer of packed codes.
+     *
+     * @param src    packed codes as written by the buffer encode()
+     * @param bytes  bytes available in src (may run past the codes wanted)
+     * @param dst    receives the count characters
+     * @param count  number of characters to decode
+     * @return       number of bits the count codes took
+     * @throws invalid_argument  if src ends first or the bits are not this object's codes
+     */
+    size_t decodeCount(const uint8_t *src, size_t bytes, uint8_t *dst, size_t count) const {
+        return table.decodeCount(src, bytes, dst, count);
+    }
+
+    /**
+     * Largest number of bytes the buffer encode() can write for n characters.
+     */
+    size_t encodedBound(size_t n) const {
+        return table.encodedBound(n);
+    }
+
+    /**
+     * The flat encode/decode tables behind the buffer encode() and decode().
+     */
+    const CodeTable& codeTable() const {
+        return table;
+    }
+
+    /**
+     * Decode just part of the original text, starting from the nearest checkpoint.
+     *
+     * @param coded   the whole bit stream that encode() filled in along with index
+     * @param index   the checkpoint index that encode() filled in
+     * @param offset  position in the original text of the first character wanted
+     * @param length  number of characters wanted (fewer are written if the text ends first)
+     * @param out     receives the characters
+     * @throws out_of_range      if offset is past the end of the text
+     * @throws invalid_argument  if coded does not match index
+     */
+    void decodeRange(const BitStreamF& coded, const CheckpointIndex& index,
+                     uint64_t offset, size_t length, std::ostream& out) const;
+
+    /**
+     * Same as above, reading the codes straight from a file written by
+     * BitStreamF::writeToFile() instead of loading all of it. Decoding starts with a seek to
+     * the 32-bit word holding the checkpoint, and only the words from there to the end of
+     * the range are read (a few KB at a time).
+     *
+     * @param coded   positioned at the start of the file's contents (e.g. a fresh ifstream)
+     * @throws invalid_argument  also if coded does not hold a saved bit stream
+     */
+    void decodeRange(std::istream& coded, const CheckpointIndex& index,
+                     uint64_t offset, size_t length, std::ostream& out) const;
+
     /**
      * Get the Huffman code for a given character (for debugging).
      *
@@ -71,7 +238,23 @@ public:
      * @param c  character
      * @return   number of observations of this character during construction from the sample
      */
-    int getFrequency(unsigned char c) const;
+    uint64_t getFrequency(unsigned char c) const;
+
+    /**
+     * Save the frequency table so an equivalent Huffman object can be constructed elsewhere.
+     *
+     * @param out  binary stream to receive MAX_CHAR+1 64-bit counts
+     */
+    void writeFrequencies(std::ostream& out) const;
+
+    /**
+     * Load a frequency table previously saved by writeFrequencies().
+     *
+     * @param in           binary stream positioned at a saved table
+     * @param frequencies  receives MAX_CHAR+1 counts
+     * @throws invalid_argument  if the stream ends before the whole table is read
+     */
+    static void readFrequencies(std::istream& in, uint64_t frequencies[]);
 
     /**
      * Print out the data for a given character. Do nothing if the character was not in the sample.
@@ -81,7 +264,7 @@ public:
      */
     void printCode(std::ostream& out, int ch) const {
         unsigned char c = to_unsigned(ch);
-        int freq = getFrequency(c);
+        uint64_t freq = getFrequency(c);
         if (freq > 0) {
             if (c == '\n')
                 out << "'\\n'";
@@ -112,12 +295,12 @@ private:
      * in the tree and the tree itself.  See the assignment write-up.
      */
     struct PQEntry {
-        int frequency;
+        uint64_t frequency;
         CodeTree *codeTree;
 
         // convience constructors
-        PQEntry(int freq, unsigned char c);
-        PQEntry(int combinedFrequency, CodeTree *lessFrequent, CodeTree *moreFrequent);
+        PQEntry(uint64_t freq, unsigned char c);
+        PQEntry(uint64_t combinedFrequency, CodeTree *lessFrequent, CodeTree *moreFrequent);
 
         // sort operator for the Priority Queue to work
         bool operator<(const PQEntry& rhs) const;
@@ -136,7 +319,7 @@ private:
     /**
      * observation count of each character in sample
      */
-    int samplecount[MAX_CHAR+1];
+    uint64_t samplecount[MAX_CHAR+1];
 
     /**
      * final code tree of the Huffman codes
@@ -151,6 +334,16 @@ private:
      */
     CodeTree *root;
 
+    /**
+     * this->codes flattened for the buffer encode() and decode()
+     */
+    CodeTable table;
+
+    /**
+     * two codes per lookup for the buffer encode(), when that beats table (else empty)
+     */
+    PairTable pairs;
+
     /**
      * Build the code table from a sample to indicate:
      *     1. the characters to accept in encoding--any characters not in the sample
@@ -162,10 +355,16 @@ private:
      *     2. calls collectFrequencies(sampleSource)
      *     3. calls buildCodeTree()
      *     4. calls populateCodes(root)
+     *     5. builds this->table (and this->pairs) from this->codes
      * @param sampleSource characters are counted from this input stream
      */
     void sample(std::istream &sampleSource);
 
+    /**
+     * Build this->table and, if it pays, this->pairs from this->codes.
+     */
+    void buildTables();
+
     /**
      * Given a bit stream, pull the next character from it by using this->root.
      *
@@ -191,9 +390,23 @@ private:
      * from the priority queue, combines them into a single BinaryNode, and enqueues that back
      * into the priority queue. When the queue has only one entry left, that contains the tree
      * of the Huffman codes and is assigned to this->root.
+     *
+     * If the tree would have a code longer than Bits::MAX_BITS (possible once counts pass about
+     * 5 million with a skewed distribution), the counts are halved and the tree rebuilt until it
+     * fits; this->sampleCount itself is left alone.
      */
     void buildCodeTree();
 
+    /**
+     * One attempt of buildCodeTree() with the given counts in place of this->sampleCount.
+     */
+    void buildCodeTree(const uint64_t weights[]);
+
+    /**
+     * Length of the longest code in a tree.
+     */
+    static int depth(const CodeTree *node);
+
     /**
      * Recursive traversal of the code tree, this->root, to find all the codes we generated, and for
      * each (i.e., each leaf of the tree), place its corresponding Huffman code in this->codes.
@@ -219,6 +432,70 @@ private:
     static unsigned char to_unsigned(char c) {
         return static_cast<unsigned char>(c);
     }
+
+    /**
+     * Implementation of both templated encode() methods (index may be null).
+     */
+    template <typename Stream>
+    void encodeIndexed(std::istream& source, Stream& codedOutput, CheckpointIndex *index) const;
+
+    /**
+     * Implementation of both decodeRange() methods; Source has size() and peekBitsAt() as
+     * BitStreamF does (defined in Huffman.cpp, the only place it is used).
+     */
+    template <typename Source>
+    void decodeRangeFrom(Source& coded, const CheckpointIndex& index,
+                         uint64_t offset, size_t length, std::ostream& out) const;
+
+    /**
+     * Characters are read from and written to the iostreams this many at a time.
+     */
+    static const int CHUNK_SIZE = 4096;
 };
 
+/*
+ * Following are the templated encode and decode (in the header file because they are templates).
+ */
+
+template <typename Stream>
+void Huffman::encodeIndexed(std::istream& source, Stream& codedOutput, CheckpointIndex *index) const {
+    char chunk[CHUNK_SIZE];
+    uint64_t bitOffset = 0;
+    while (source.read(chunk, CHUNK_SIZE) || source.gcount() > 0) {
+        std::streamsize n = source.gcount();
+        for (std::streamsize i = 0; i < n; i++) {
+            unsigned char c = to_unsigned(chunk[i]);
+            int length = table.codeLength(c);
+            if (length == 0)
+                throw std::invalid_argument("character not in the sample: " + std::to_string(c));
+            if (index != nullptr)
+                index->observe(bitOffset);
+            codedOutput.putBits(table.codeBits(c), length);
+            bitOffset += length;
+        }
+    }
+}
+
+template <typename Stream>
+void Huffman::decode(Stream& codedInput, std::ostream& out) const {
+    char chunk[CHUNK_SIZE];
+    int n = 0;
+    for (size_t remaining = codedInput.size(); remaining > 0; ) {
+        uint8_t c;
+        size_t length = table.decodeOne(codedInput.peekBits(remaining < 64 ? (int)remaining : 64), c);
+        if (length == 0)
+            throw std::invalid_argument("Code doesn't work");
+        if (length > remaining)
+            throw std::invalid_argument("Bit stream early ending");
+        codedInput.consumeBits((int)length);
+        remaining -= length;
+        chunk[n++] = (char)c;
+        if (n == CHUNK_SIZE) {
+            out.write(chunk, n);
+            n = 0;
+        }
+    }
+    out.write(chunk, n);
+}
+
 
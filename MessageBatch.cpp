@@ -0,0 +1,76 @@
+/**
+ * @file MessageBatch.cpp - Many small messages coded into one buffer against a shared model.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <stdexcept>
+#include "MessageBatch.h"
+using namespace std;
+
+MessageBatch::MessageBatch(const Huffman& model) : model(model) {
+}
+
+void MessageBatch::encode(const vector<string>& messages, string& batch, vector<uint64_t>& offsets) const {
+    // size the buffer once for the worst case, then trim it at the end
+    size_t bound = 0;
+    for (const string& m: messages)
+        bound += MAX_VARINT + model.encodedBound(m.size());
+    size_t original = batch.size();
+    size_t pos = original;
+    batch.resize(pos + bound);
+    offsets.clear();
+    try {
+        offsets.reserve(messages.size());
+        uint8_t *dst = (uint8_t *)&batch[0];
+        for (const string& m: messages) {
+            offsets.push_back(pos);
+            uint64_t length = m.size();
+            while (length >= 0x80) {
+                dst[pos++] = (uint8_t)(length | 0x80);
+                length >>= 7;
+            }
+            dst[pos++] = (uint8_t)length;
+            size_t bits = model.encode((const uint8_t *)m.data(), m.size(), dst + pos, batch.size() - pos);
+            pos += (bits + 7) / 8;
+        }
+    } catch (...) {
+        // leave the batch as it was rather than padded out with a partial record
+        batch.resize(original);
+        offsets.clear();
+        throw;
+    }
+    batch.resize(pos);
+}
+
+uint64_t MessageBatch::decodeAt(const string& batch, uint64_t offset, string& message) const {
+    const uint8_t *src = (const uint8_t *)batch.data();
+    size_t size = batch.size();
+    uint64_t length = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (offset >= size || shift >= 64)
+            throw invalid_argument("batch record length is malformed");
+        uint8_t b = src[offset++];
+        length |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+    // every character takes at least one bit
+    if (length > 8 * (size - offset))
+        throw invalid_argument("batch record is longer than the batch");
+    message.resize(length);
+    if (length == 0)
+        return offset;
+    size_t bits = model.decodeCount(src + offset, size - offset, (uint8_t *)&message[0], length);
+    return offset + (bits + 7) / 8;
+}
+
+void MessageBatch::decode(const string& batch, vector<string>& messages) const {
+    size_t n = 0;
+    for (uint64_t pos = 0; pos < batch.size(); n++) {
+        if (n == messages.size())
+            messages.emplace_back();
+        pos = decodeAt(batch, pos, messages[n]);
+    }
+    messages.resize(n);
+}
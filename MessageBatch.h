@@ -0,0 +1,75 @@
+/**
+ * @file MessageBatch.h - Many small messages coded into one buffer against a shared model.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Huffman.h"
+
+/**
+ * @class MessageBatch - codes a whole vector of short messages in one call.
+ *
+ * Coding a 50-byte message on its own through a BitStreamF costs an object, an istream,
+ * and a file header and word padding bigger than the savings. Here every message is one
+ * record in a single output buffer:
+ *     varint length in characters (7 bits per byte, low-order group first),
+ *     the message's Huffman codes, padded with zero bits to a whole byte
+ * so each message costs one length byte (two past 127 characters) plus under a byte of
+ * padding. Records are byte-aligned, so the offsets returned by encode() let any one
+ * message be decoded without the ones before it.
+ *
+ * The model is not stored in the batch; the decoder must be given an equivalent one.
+ * A MessageBatch has no mutable state, so one object may be used from several threads.
+ */
+class MessageBatch {
+public:
+    /**
+     * @param model  the Huffman codes for every message, must outlive this object
+     */
+    explicit MessageBatch(const Huffman& model);
+
+    /**
+     * Append one record per message to a batch.
+     *
+     * @param messages  the messages, in order
+     * @param batch     the records are appended to this
+     * @param offsets   cleared, then receives the position in batch of each message's record
+     * @throws invalid_argument  if a message has a character the model cannot code, in
+     *                           which case batch is as it was and offsets is empty
+     */
+    void encode(const std::vector<std::string>& messages, std::string& batch,
+                std::vector<uint64_t>& offsets) const;
+
+    /**
+     * Decode every record in a batch.
+     *
+     * @param batch     records written by encode()
+     * @param messages  receives the messages in order (its strings are reused)
+     * @throws invalid_argument  if the batch is malformed
+     */
+    void decode(const std::string& batch, std::vector<std::string>& messages) const;
+
+    /**
+     * Decode just the record at one offset.
+     *
+     * @param batch    records written by encode()
+     * @param offset   position of the record, as returned by encode()
+     * @param message  receives the message
+     * @return         position of the following record
+     * @throws invalid_argument  if there is no well-formed record at offset
+     */
+    uint64_t decodeAt(const std::string& batch, uint64_t offset, std::string& message) const;
+
+private:
+    const Huffman& model;
+
+    /**
+     * Most bytes a varint length can take.
+     */
+    static const size_t MAX_VARINT = 10;
+};
@@ -0,0 +1,233 @@
+/**
+ * @file ModelRegistry.cpp - Cache of ready-to-use code tables for many models.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ModelRegistry.h"
+using namespace std;
+
+static_assert(is_trivially_copyable<CodeTable>::value, "CodeTable must be usable straight from a mapped file");
+
+namespace {
+
+/*
+ * File layout: FileHeader, count FileEntry's, then the tables, each starting on a
+ * TABLE_ALIGN boundary so that a cold table's pages can be released on their own.
+ */
+const char MAGIC[8] = {'H', 'U', 'F', 'T', 'A', 'B', 'L', '1'};
+const uint64_t TABLE_ALIGN = 4096;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t tableSize;  // sizeof(CodeTable) in the build that wrote the file
+    uint32_t count;      // number of tables
+};
+
+struct FileEntry {
+    uint64_t id;
+    uint64_t offset;  // of the table from the start of the file
+};
+
+}
+
+/*
+ * A read-only mapping of a whole file, unmapped when the last table from it is let go.
+ */
+struct ModelRegistry::Mapping {
+    void *base;
+    size_t size;
+
+    Mapping(void *base, size_t size) : base(base), size(size) {}
+
+    ~Mapping() {
+        munmap(base, size);
+    }
+
+    /**
+     * Let the kernel reclaim the pages that lie entirely within the table (they are
+     * read back in from the file if the table is used again).
+     */
+    void release(const CodeTable *table) const {
+        uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+        uintptr_t start = ((uintptr_t)table + page - 1) / page * page;
+        uintptr_t end = ((uintptr_t)table + sizeof(CodeTable)) / page * page;
+        if (start < end)
+            madvise((void *)start, end - start, MADV_DONTNEED);
+    }
+};
+
+ModelRegistry::ModelRegistry(size_t budget) : lock(), entries(), lru(), budget(budget), used(0) {
+}
+
+ModelRegistry::~ModelRegistry() {
+}
+
+void ModelRegistry::add(uint64_t id, const uint64_t frequencies[]) {
+    bool any = false;
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        any = any || frequencies[c] > 0;
+    if (!any)
+        throw invalid_argument("a model needs at least one character with a non-zero frequency");
+    lock_guard<mutex> guard(lock);
+    if (entries.count(id) != 0)
+        throw invalid_argument("model " + to_string(id) + " is already registered");
+    Entry& entry = entries[id];
+    copy(frequencies, frequencies + Huffman::MAX_CHAR + 1, entry.frequencies.begin());
+    entry.mapped = nullptr;
+}
+
+void ModelRegistry::mapFile(string filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw invalid_argument(string("cannot open file ") + filename + " to map models");
+    struct stat st;
+    void *base = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        throw invalid_argument(string("cannot map file ") + filename);
+    shared_ptr<Mapping> mapping = make_shared<Mapping>(base, (size_t)st.st_size);
+
+    const char *bytes = (const char *)base;
+    FileHeader header;
+    if (mapping->size < sizeof(header))
+        throw invalid_argument(string("file ") + filename + " is not a table file");
+    memcpy(&header, bytes, sizeof(header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        throw invalid_argument(string("file ") + filename + " is not a table file");
+    if (header.tableSize != sizeof(CodeTable))
+        throw invalid_argument(string("file ") + filename + " was written by an incompatible build");
+    if (sizeof(header) + (uint64_t)header.count * sizeof(FileEntry) > mapping->size)
+        throw invalid_argument(string("file ") + filename + " is truncated");
+
+    vector<FileEntry> files(header.count);
+    memcpy(files.data(), bytes + sizeof(header), files.size() * sizeof(FileEntry));
+    for (const FileEntry& f: files)
+        if (f.offset % alignof(CodeTable) != 0 || f.offset > mapping->size ||
+            mapping->size - f.offset < sizeof(CodeTable))
+            throw invalid_argument(string("file ") + filename + " is truncated");
+
+    // every index and length in a table is trusted when coding, so check them all now
+    for (const FileEntry& f: files) {
+        const CodeTable *table = (const CodeTable *)(bytes + f.offset);
+        if (!table->wellFormed())
+            throw invalid_argument(string("file ") + filename + " has a corrupt table for model " +
+                                   to_string(f.id));
+        mapping->release(table);
+    }
+
+    lock_guard<mutex> guard(lock);
+    for (const FileEntry& f: files)
+        if (entries.count(f.id) != 0)
+            throw invalid_argument("model " + to_string(f.id) + " is already registered");
+    for (const FileEntry& f: files) {
+        Entry& entry = entries[f.id];
+        entry.mapping = mapping;
+        entry.mapped = (const CodeTable *)(bytes + f.offset);
+    }
+}
+
+shared_ptr<const CodeTable> ModelRegistry::get(uint64_t id) {
+    unique_lock<mutex> guard(lock);
+    auto found = entries.find(id);
+    if (found == entries.end())
+        throw out_of_range("model " + to_string(id) + " is not registered");
+    Entry& entry = found->second;  // entries are never erased, so this stays valid unlocked
+    if (entry.ready) {
+        lru.splice(lru.begin(), lru, entry.lruPosition);
+        return entry.ready;
+    }
+
+    shared_ptr<const CodeTable> table;
+    if (entry.mapping) {
+        table = shared_ptr<const CodeTable>(entry.mapping, entry.mapped);
+    } else {
+        // building takes a while, so let other lookups go ahead meanwhile
+        guard.unlock();
+        Huffman model(entry.frequencies.data());
+        table = make_shared<const CodeTable>(model.codeTable());
+        guard.lock();
+        if (entry.ready) {  // another thread built it first
+            lru.splice(lru.begin(), lru, entry.lruPosition);
+            return entry.ready;
+        }
+    }
+    entry.ready = table;
+    lru.push_front(id);
+    entry.lruPosition = lru.begin();
+    used += sizeof(CodeTable);
+    evict(id);
+    return table;
+}
+
+void ModelRegistry::evict(uint64_t keep) {
+    while (used > budget && !lru.empty() && lru.back() != keep) {
+        Entry& entry = entries[lru.back()];
+        lru.pop_back();
+        if (entry.mapping)
+            entry.mapping->release(entry.mapped);
+        entry.ready.reset();
+        used -= sizeof(CodeTable);
+    }
+}
+
+bool ModelRegistry::contains(uint64_t id) const {
+    lock_guard<mutex> guard(lock);
+    return entries.count(id) != 0;
+}
+
+size_t ModelRegistry::memoryUsed() const {
+    lock_guard<mutex> guard(lock);
+    return used;
+}
+
+void ModelRegistry::writeTables(string filename, const vector<pair<uint64_t, const Huffman *>>& models) {
+    ofstream f;
+    f.open(filename, ios::binary | ios::out);
+    if (!f.is_open())
+        throw invalid_argument(string("cannot open file ") + filename + " to write tables");
+    FileHeader header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.tableSize = sizeof(CodeTable);
+    header.count = (uint32_t)models.size();
+    f.write((const char *)&header, sizeof(header));
+
+    vector<uint64_t> offsets;
+    uint64_t at = sizeof(header) + models.size() * sizeof(FileEntry);
+    for (size_t i = 0; i < models.size(); i++) {
+        uint64_t offset = (at + TABLE_ALIGN - 1) / TABLE_ALIGN * TABLE_ALIGN;
+        offsets.push_back(offset);
+        at = offset + sizeof(CodeTable);
+        FileEntry entry = {models[i].first, offset};
+        f.write((const char *)&entry, sizeof(entry));
+    }
+    vector<char> padding(TABLE_ALIGN, 0);
+    at = sizeof(header) + models.size() * sizeof(FileEntry);
+    for (size_t i = 0; i < models.size(); i++) {
+        f.write(padding.data(), offsets[i] - at);
+        f.write((const char *)&models[i].second->codeTable(), sizeof(CodeTable));
+        at = offsets[i] + sizeof(CodeTable);
+    }
+    if (!f)
+        throw runtime_error(string("cannot write tables to file ") + filename);
+}
+
+uint64_t ModelRegistry::hash(const uint64_t frequencies[]) {
+    uint64_t h = 14695981039346656037ULL;
+    const uint8_t *bytes = (const uint8_t *)frequencies;
+    for (size_t i = 0; i < (Huffman::MAX_CHAR + 1) * sizeof(uint64_t); i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file ModelRegistry.h - Cache of ready-to-use code tables for many models.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "CodeTable.h"
+#include "Huffman.h"
+
+/**
+ * @class ModelRegistry - finds the CodeTable for a model ID, building or mapping it on demand.
+ *
+ * Models are registered either by frequency table (add()), in which case the table is built
+ * the first time it is asked for, or by mapping a file of prebuilt tables (mapFile()). A
+ * CodeTable holds no pointers, so a prebuilt table is used right where it lies in the mapped
+ * file with no parsing or copying, and the pages are shared with every other process that maps
+ * the same file.
+ *
+ * Tables in use are kept in least-recently-used order, and once they take more than the memory
+ * budget the least recently used are dropped: built tables are freed and mapped tables have
+ * their pages released back to the page cache. A table handed out by get() stays valid for as
+ * long as the caller holds on to it, even after it has been dropped from the registry.
+ *
+ * All methods may be called from several threads at once.
+ */
+class ModelRegistry {
+public:
+    static const size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+    /**
+     * @param budget  bytes of tables to keep ready before dropping the least recently used
+     */
+    explicit ModelRegistry(size_t budget = DEFAULT_BUDGET);
+
+    // big 5 (holds a lock and mappings, so neither copying nor moving is allowed)
+    ~ModelRegistry();
+    ModelRegistry(const ModelRegistry& other) = delete;
+    ModelRegistry(ModelRegistry&& temp) = delete;
+    ModelRegistry& operator=(const ModelRegistry& other) = delete;
+    ModelRegistry& operator=(ModelRegistry&& temp) = delete;
+
+    /**
+     * Register a model to be built from frequencies the first time it is wanted.
+     *
+     * @param id           the model's ID (see hash() to key models by their content)
+     * @param frequencies  observation count of each character 0..MAX_CHAR, as for Huffman
+     * @throws invalid_argument  if the ID is already registered
+     */
+    void add(uint64_t id, const uint64_t frequencies[]);
+
+    /**
+     * Register every model in a file written by writeTables(). The file is mapped now and
+     * each table is read through once to check it is well formed (see
+     * CodeTable::wellFormed()); its pages are then released until the table is used.
+     *
+     * @param filename  path to a file previously written by writeTables()
+     * @throws invalid_argument  if the file cannot be mapped, was written by a different build,
+     *                           has a corrupt table, or has an ID that is already registered
+     */
+    void mapFile(std::string filename);
+
+    /**
+     * The code tables for a model.
+     *
+     * @param id  a registered model ID
+     * @return    the tables, valid for as long as the caller keeps the pointer
+     * @throws out_of_range  if the ID was never registered
+     */
+    std::shared_ptr<const CodeTable> get(uint64_t id);
+
+    /**
+     * Whether the ID has been registered.
+     */
+    bool contains(uint64_t id) const;
+
+    /**
+     * Bytes of tables currently kept ready.
+     */
+    size_t memoryUsed() const;
+
+    /**
+     * Write the tables of several models to a file for mapFile().
+     *
+     * The file holds the tables exactly as they are in memory, so it can only be mapped by a
+     * program built the same way (this is checked by mapFile()).
+     * @param filename  name of the file to write (will overwrite any existing file of the same name)
+     * @param models    each model's ID and Huffman object
+     */
+    static void writeTables(std::string filename,
+                            const std::vector<std::pair<uint64_t, const Huffman *>>& models);
+
+    /**
+     * A 64-bit ID for a frequency table (FNV-1a of the counts), for keying models by content.
+     */
+    static uint64_t hash(const uint64_t frequencies[]);
+
+private:
+    struct Mapping;
+
+    /*
+     * Where a registered model comes from, and its tables while they are kept ready.
+     */
+    struct Entry {
+        std::array<uint64_t, Huffman::MAX_CHAR+1> frequencies;  // if not mapped
+        std::shared_ptr<Mapping> mapping;                  // null if built from frequencies
+        const CodeTable *mapped;                           // the table within mapping
+        std::shared_ptr<const CodeTable> ready;            // null when not kept ready
+        std::list<uint64_t>::iterator lruPosition;         // valid when ready
+    };
+
+    mutable std::mutex lock;
+    std::unordered_map<uint64_t, Entry> entries;
+    std::list<uint64_t> lru;  // IDs of ready entries, most recently used first
+    size_t budget;
+    size_t used;
+
+    /**
+     * Drop least recently used tables (never keep) until the budget is met.
+     */
+    void evict(uint64_t keep);
+};
@@ -0,0 +1,153 @@
+/**
+ * @file ModelSet.cpp - A few Huffman models trained on a whole corpus.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <fstream>
+#include <stdexcept>
+#include "ModelSet.h"
+#include "CompressibilityProbe.h"
+using namespace std;
+
+ModelSet::ModelSet() : models() {
+}
+
+size_t ModelSet::add(const uint64_t frequencies[]) {
+    models.emplace_back(new Huffman(frequencies));
+    return models.size() - 1;
+}
+
+size_t ModelSet::addFromHistogram(const Histogram& sum) {
+    Histogram frequencies;
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        frequencies[c] = sum[c] + 1;
+    return add(frequencies.data());
+}
+
+size_t ModelSet::select(const uint64_t histogram[]) const {
+    if (models.empty())
+        throw out_of_range("no models to select from");
+    size_t best = 0;
+    uint64_t bestBits = UINT64_MAX;
+    for (size_t i = 0; i < models.size(); i++) {
+        uint64_t bits = CompressibilityProbe::huffmanBits(histogram, *models[i]);
+        if (bits < bestBits) {
+            best = i;
+            bestBits = bits;
+        }
+    }
+    return best;
+}
+
+uint64_t ModelSet::cost(const vector<Histogram>& corpus) const {
+    uint64_t total = 0;
+    for (const auto& h: corpus)
+        total += CompressibilityProbe::huffmanBits(h.data(), *models[select(h.data())]);
+    return total;
+}
+
+void ModelSet::count(istream& in, Histogram& histogram) {
+    char chunk[4096];
+    while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0)
+        for (streamsize i = 0; i < in.gcount(); i++)
+            histogram[(unsigned char)chunk[i]]++;
+}
+
+ModelSet ModelSet::train(const vector<Histogram>& corpus, int k, int iterations) {
+    if (corpus.empty() || k < 1)
+        throw invalid_argument("need at least one file and one model to train");
+    ModelSet set;
+
+    // seed with the biggest file, then keep adding the file the current models serve worst
+    size_t biggest = 0;
+    uint64_t biggestTotal = 0;
+    for (size_t f = 0; f < corpus.size(); f++) {
+        uint64_t total = 0;
+        for (uint64_t n: corpus[f])
+            total += n;
+        if (total > biggestTotal) {
+            biggest = f;
+            biggestTotal = total;
+        }
+    }
+    set.addFromHistogram(corpus[biggest]);
+    while ((int)set.size() < k) {
+        size_t worst = 0;
+        uint64_t worstLoss = 0;
+        for (size_t f = 0; f < corpus.size(); f++) {
+            uint64_t current = CompressibilityProbe::huffmanBits(corpus[f].data(),
+                                                                 *set.models[set.select(corpus[f].data())]);
+            uint64_t own = CompressibilityProbe::huffmanBits(corpus[f].data());
+            if (current > own && current - own > worstLoss) {
+                worst = f;
+                worstLoss = current - own;
+            }
+        }
+        if (worstLoss == 0)
+            break;  // every file is already coded as well as its own codes would
+        set.addFromHistogram(corpus[worst]);
+    }
+
+    // k-means: assign each file to its cheapest model, then rebuild each model from its files
+    vector<size_t> assigned(corpus.size(), SIZE_MAX);
+    for (int round = 0; round < iterations; round++) {
+        bool moved = false;
+        for (size_t f = 0; f < corpus.size(); f++) {
+            size_t m = set.select(corpus[f].data());
+            moved = moved || m != assigned[f];
+            assigned[f] = m;
+        }
+        if (!moved)
+            break;
+        ModelSet next;
+        for (size_t m = 0; m < set.size(); m++) {
+            Histogram sum = {};
+            bool used = false;
+            for (size_t f = 0; f < corpus.size(); f++) {
+                if (assigned[f] != m)
+                    continue;
+                used = true;
+                for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+                    sum[c] += corpus[f][c];
+            }
+            if (used)
+                next.addFromHistogram(sum);
+        }
+        // model numbers change when a cluster empties, so reassign from scratch next round
+        if (next.size() != set.size())
+            assigned.assign(corpus.size(), SIZE_MAX);
+        set = move(next);
+    }
+    return set;
+}
+
+/*
+ * File layout: uint32 number of models, then each model's frequency table
+ * (see Huffman::writeFrequencies).
+ */
+void ModelSet::writeToFile(string filename) const {
+    ofstream f;
+    f.open(filename, ios::binary | ios::out);
+    if (!f.is_open())
+        throw invalid_argument(string("cannot open file ") + filename + " to write models");
+    uint32_t n = (uint32_t)models.size();
+    f.write((const char *)&n, sizeof(n));
+    for (const auto& m: models)
+        m->writeFrequencies(f);
+}
+
+ModelSet::ModelSet(string filename) : models() {
+    ifstream f;
+    f.open(filename, ios::binary | ios::in);
+    if (!f.is_open())
+        throw invalid_argument(string("cannot open file ") + filename + " to read models");
+    uint32_t n;
+    if (!f.read((char *)&n, sizeof(n)))
+        throw invalid_argument(string("file ") + filename + " is not a model set");
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t frequencies[Huffman::MAX_CHAR+1];
+        Huffman::readFrequencies(f, frequencies);
+        add(frequencies);
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ * @file ModelSet.h - A few Huffman models trained on a whole corpus.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Huffman.h"
+
+/**
+ * @class ModelSet - K representative Huffman models for a corpus of files.
+ *
+ * Training clusters the character histograms of the corpus files with k-means, where
+ * the distance from a file to a model is the number of bits the model would code the
+ * file into. Each model is built from the summed histograms of its cluster, with every
+ * character given at least a count of one so that any model can code any text.
+ *
+ * At compression time select() picks the model that codes a given histogram smallest
+ * (BlockCodec does this for each block and records the choice in the frame), which comes
+ * close to per-file models without storing a table with every small file.
+ */
+class ModelSet {
+public:
+    typedef std::array<uint64_t, Huffman::MAX_CHAR+1> Histogram;
+
+    /**
+     * Construct an empty set, suitable for add().
+     */
+    ModelSet();
+
+    /**
+     * Load a set previously saved with writeToFile().
+     * @param filename  path to file previously saved via writeToFile() method
+     */
+    explicit ModelSet(std::string filename);
+
+    // big 5 (the models are owned, so only moving is allowed)
+    ~ModelSet() = default;
+    ModelSet(const ModelSet& other) = delete;
+    ModelSet(ModelSet&& temp) = default;
+    ModelSet& operator=(const ModelSet& other) = delete;
+    ModelSet& operator=(ModelSet&& temp) = default;
+
+    /**
+     * Train k models on a corpus.
+     *
+     * @param corpus      one histogram per file (see count())
+     * @param k           number of models wanted (fewer if there are fewer distinct files)
+     * @param iterations  most rounds of k-means to run
+     * @return            the trained models
+     */
+    static ModelSet train(const std::vector<Histogram>& corpus, int k, int iterations = 20);
+
+    /**
+     * Add the characters read from in (to EOF) to a histogram.
+     */
+    static void count(std::istream& in, Histogram& histogram);
+
+    /**
+     * Add a model built from the given frequencies.
+     * @return  index of the new model
+     */
+    size_t add(const uint64_t frequencies[]);
+
+    /**
+     * Number of models in the set.
+     */
+    size_t size() const {
+        return models.size();
+    }
+
+    /**
+     * The i'th model.
+     */
+    const Huffman& get(size_t i) const {
+        return *models.at(i);
+    }
+
+    /**
+     * Index of the model that codes the histogram in the fewest bits.
+     * @pre  size() > 0
+     */
+    size_t select(const uint64_t histogram[]) const;
+
+    /**
+     * Total bits the best model for each file would code the whole corpus into.
+     */
+    uint64_t cost(const std::vector<Histogram>& corpus) const;
+
+    /**
+     * Write the models out to the given file.
+     * @param filename  name of the file to write (will overwrite any existing file of the same name)
+     */
+    void writeToFile(std::string filename) const;
+
+private:
+    std::vector<std::unique_ptr<Huffman>> models;
+
+    /**
+     * Add a model for the summed histogram, with no zero counts.
+     */
+    size_t addFromHistogram(const Histogram& sum);
+};
@@ -0,0 +1,230 @@
+/**
+ * @file Pipeline.cpp - Three-stage threaded reader/coder/writer driver for BlockCodec.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Pipeline.h"
+#include "adts/QueueRing.h"
+using namespace std;
+
+namespace {
+
+/*
+ * One reusable buffer: the stage's input and the coder's output.
+ */
+struct Buffer {
+    string text;
+    string frame;
+};
+
+/*
+ * Bounded blocking hand-off between two stages. Each channel has one thread pushing and
+ * one popping, so the hand-off itself is a lock-free ring; the mutex and condition
+ * variable are only for a stage that finds the ring full (or empty) and has to sleep.
+ * A null Buffer marks the end of the stream. Once closed (because some stage failed)
+ * every push and pop gives up.
+ */
+class Channel {
+public:
+    explicit Channel(size_t capacity) : q(capacity), sleepers(0), closed(false) {}
+
+    bool push(Buffer *buffer) {
+        return wait([&]() { return q.try_enqueue(buffer); });
+    }
+
+    bool pop(Buffer *&buffer) {
+        return wait([&]() { return q.try_dequeue(buffer); });
+    }
+
+    void close() {
+        closed = true;
+        lock_guard<mutex> lock(m);
+        changed.notify_all();
+    }
+
+private:
+    QueueSPSC<Buffer *> q;
+    mutex m;
+    condition_variable changed;
+    atomic<int> sleepers;
+    atomic<bool> closed;
+
+    /*
+     * Retry attempt until it succeeds or the channel is closed, sleeping in between.
+     */
+    template <typename Attempt>
+    bool wait(Attempt attempt) {
+        if (closed)
+            return false;
+        if (!attempt()) {
+            unique_lock<mutex> lock(m);
+            sleepers++;
+            // pairs with the fence in wake(): either it sees this sleeper or the retry
+            // below sees its hand-off
+            atomic_thread_fence(memory_order_seq_cst);
+            bool done = false;
+            changed.wait(lock, [&]() { return closed || (done = attempt()); });
+            sleepers--;
+            if (!done)
+                return false;
+        }
+        wake();
+        return true;
+    }
+
+    /*
+     * Wake the other side if it is asleep waiting for the hand-off just made.
+     */
+    void wake() {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (sleepers > 0) {
+            lock_guard<mutex> lock(m);
+            changed.notify_all();
+        }
+    }
+};
+
+}
+
+Pipeline::Pipeline(const BlockCodec& codec, size_t blockSize, int buffers, AdaptiveModel *adaptive)
+        : codec(codec), blockSize(blockSize), buffers(buffers), adaptive(adaptive) {
+    if (blockSize == 0)
+        throw invalid_argument("block size must be positive");
+    if (buffers < 2)
+        throw invalid_argument("pipeline needs at least two buffers");
+}
+
+void Pipeline::compress(istream& in, ostream& out) const {
+    run(in, out, true);
+}
+
+void Pipeline::decompress(istream& in, ostream& out) const {
+    run(in, out, false);
+}
+
+void Pipeline::run(istream& in, ostream& out, bool compressing) const {
+    vector<Buffer> pool(buffers);
+    Channel empty(buffers), toCoder(buffers), toWriter(buffers);
+    for (auto& b: pool)
+        empty.push(&b);
+
+    mutex errorLock;
+    exception_ptr error;
+    auto fail = [&]() {
+        {
+            lock_guard<mutex> lock(errorLock);
+            if (!error)
+                error = current_exception();
+        }
+        empty.close();
+        toCoder.close();
+        toWriter.close();
+    };
+
+    thread reader([&]() {
+        try {
+            uint64_t frames = 0;
+            Buffer *b;
+            while (empty.pop(b)) {
+                bool more;
+                if (compressing) {
+                    b->text.resize(blockSize);
+                    in.read(&b->text[0], blockSize);
+                    b->text.resize(in.gcount());
+                    more = !b->text.empty();
+                } else {
+                    try {
+                        more = BlockCodec::readFrame(in, b->frame);
+                    } catch (const invalid_argument& e) {
+                        throw CorruptFrame(frames, e.what());
+                    }
+                }
+                frames++;
+                if (!toCoder.push(more ? b : nullptr) || !more)
+                    return;
+            }
+        } catch (...) {
+            fail();
+        }
+    });
+
+    thread writer([&]() {
+        try {
+            Buffer *b;
+            while (toWriter.pop(b)) {
+                if (b == nullptr) {
+                    if (compressing)
+                        BlockCodec::writeEnd(out);
+                    out.flush();
+                    return;
+                }
+                const string& result = compressing ? b->frame : b->text;
+                if (!out.write(result.data(), result.size()))
+                    throw runtime_error("pipeline cannot write output");
+                if (!empty.push(b))
+                    return;
+            }
+        } catch (...) {
+            fail();
+        }
+    });
+
+    // the coder stage runs on the calling thread
+    try {
+        uint64_t frames = 0;
+        unique_ptr<Huffman> embedded;  // model from the last MODEL frame decoded
+        Buffer *b;
+        while (toCoder.pop(b)) {
+            if (b != nullptr) {
+                if (compressing && adaptive != nullptr) {
+                    // blocks are the boundaries where a rebuilt model may come in
+                    bool changed = adaptive->swap() || frames == 0;
+                    shared_ptr<const Huffman> model = adaptive->current();
+                    codec.encode(b->text, b->frame, *model);
+                    adaptive->observe((const uint8_t *)b->text.data(), b->text.size());
+                    if (changed) {
+                        string modelFrame;
+                        BlockCodec::encodeModel(*model, modelFrame);
+                        b->frame.insert(0, modelFrame);
+                    }
+                } else if (compressing) {
+                    codec.encode(b->text, b->frame);
+                } else {
+                    try {
+                        uint64_t frequencies[Huffman::MAX_CHAR+1];
+                        if (BlockCodec::decodeModel(b->frame, frequencies)) {
+                            embedded.reset(new Huffman(frequencies));
+                            b->text.clear();
+                        } else if (embedded) {
+                            codec.decode(b->frame, b->text, *embedded);
+                        } else {
+                            codec.decode(b->frame, b->text);
+                        }
+                    } catch (const invalid_argument& e) {
+                        throw CorruptFrame(frames, e.what());
+                    }
+                }
+                frames++;
+            }
+            if (!toWriter.push(b) || b == nullptr)
+                break;
+        }
+    } catch (...) {
+        fail();
+    }
+
+    reader.join();
+    writer.join();
+    if (error)
+        rethrow_exception(error);
+}
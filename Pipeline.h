@@ -0,0 +1,62 @@
+/**
+ * @file Pipeline.h - Three-stage threaded reader/coder/writer driver for BlockCodec.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <iostream>
+#include "AdaptiveModel.h"
+#include "BlockCodec.h"
+
+/**
+ * @class Pipeline - overlaps file reading, coding and file writing.
+ *
+ * A reader thread fills buffers from the input, the calling thread codes them with a
+ * BlockCodec, and a writer thread flushes the results. The stages hand buffers to each
+ * other through bounded queues, and the writer hands emptied buffers back to the reader,
+ * so no buffer is allocated after start-up. With the default of four buffers every stage
+ * can be busy at once and wall-clock time approaches the slowest stage rather than the
+ * sum of all three.
+ *
+ * With an AdaptiveModel, compress() codes each block with the adaptive model's current
+ * codes and writes a MODEL frame before the first block and after each swap, so the
+ * stream carries its own models. decompress() follows MODEL frames in any stream.
+ */
+class Pipeline {
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+    static const int DEFAULT_BUFFERS = 4;
+
+    /**
+     * @param codec      codes each block, must outlive this object
+     * @param blockSize  bytes of text per frame when compressing
+     * @param buffers    number of recycled buffers shared by the three stages (at least 2)
+     * @param adaptive   if not null, compress with this model instead of the codec's (the
+     *                   codec's other settings still apply); must outlive this object
+     */
+    explicit Pipeline(const BlockCodec& codec, size_t blockSize = DEFAULT_BLOCK_SIZE,
+                      int buffers = DEFAULT_BUFFERS, AdaptiveModel *adaptive = nullptr);
+
+    /**
+     * Compress all of in (to EOF) onto out as a stream of frames.
+     *
+     * @throws  whatever any stage threw, after all three stages have stopped
+     */
+    void compress(std::istream& in, std::ostream& out) const;
+
+    /**
+     * Decompress a stream of frames written by compress().
+     *
+     * @throws CorruptFrame  naming the first frame that is malformed or fails its checksum
+     */
+    void decompress(std::istream& in, std::ostream& out) const;
+
+private:
+    const BlockCodec& codec;
+    size_t blockSize;
+    int buffers;
+    AdaptiveModel *adaptive;
+
+    void run(std::istream& in, std::ostream& out, bool compressing) const;
+};
@@ -0,0 +1,211 @@
+/**
+ * @file StreamCodec.cpp - Resumable Huffman coding of a stream that arrives in pieces.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <stdexcept>
+#include "StreamCodec.h"
+using namespace std;
+
+StreamEncoder::StreamEncoder(const Huffman& model)
+        : table(model.codeTable()), pending(0), pendingLength(0), bits(0) {
+}
+
+void StreamEncoder::write(const uint8_t *text, size_t n, string& out) {
+    // check the whole chunk first, so a bad character leaves the encoder as it was
+    for (size_t i = 0; i < n; i++)
+        if (table.codeLength(text[i]) == 0)
+            throw invalid_argument("character not in the sample: " + to_string(text[i]));
+
+    size_t start = out.size();
+    out.resize(start + table.encodedBound(n) + 8);
+    uint8_t *dst = (uint8_t *)&out[start];
+    size_t at = 0;
+    for (size_t i = 0; i < n; i++) {
+        int length = table.codeLength(text[i]);
+        pending |= (uint64_t)table.codeBits(text[i]) << pendingLength;
+        pendingLength += length;
+        bits += length;
+        if (pendingLength >= 32) {
+            for (int b = 0; b < 4; b++)
+                dst[at++] = (uint8_t)(pending >> (8 * b));
+            pending >>= 32;
+            pendingLength -= 32;
+        }
+    }
+    for (; pendingLength >= 8; pendingLength -= 8) {
+        dst[at++] = (uint8_t)pending;
+        pending >>= 8;
+    }
+    out.resize(start + at);
+}
+
+uint64_t StreamEncoder::finish(string& out) {
+    if (pendingLength > 0)
+        out += (char)(uint8_t)pending;
+    pending = 0;
+    pendingLength = 0;
+    return bits;
+}
+
+StreamDecoder::StreamDecoder(const Huffman& model)
+        : table(model.codeTable()), window(0), windowLength(0), holding(false), held(0),
+          received(0), consumed(0) {
+}
+
+void StreamDecoder::write(const uint8_t *code, size_t n, string& out) {
+    if (n == 0)
+        return;
+    received += n;
+    if (holding)
+        decode(&held, 1, UINT64_MAX, out);
+    decode(code, n - 1, UINT64_MAX, out);
+    holding = true;
+    held = code[n - 1];
+}
+
+void StreamDecoder::finish(uint64_t bitCount, string& out) {
+    if (bitCount > 8 * received || 8 * received - bitCount >= 8)
+        throw invalid_argument("bit count does not match the stream");
+    if (holding)
+        decode(&held, 1, bitCount, out);
+    holding = false;
+    if (consumed != bitCount)
+        throw invalid_argument("Bit stream early ending");
+    window = 0;
+    windowLength = 0;
+}
+
+void StreamDecoder::decode(const uint8_t *code, size_t n, uint64_t limit, string& out) {
+    size_t start = out.size();
+    out.resize(start + 8 * n + 64);  // every code is at least one bit
+    uint8_t *dst = (uint8_t *)&out[start];
+    size_t at = 0;
+    int maxLength = table.maxCodeLength();
+    size_t i = 0;
+    for (;;) {
+        while (windowLength <= 56 && i < n) {
+            window |= (uint64_t)code[i++] << windowLength;
+            windowLength += 8;
+        }
+        // decode while the window holds a whole code (any shorter and the chunk ran dry)
+        if (consumed >= limit || windowLength == 0)
+            break;
+        uint8_t c;
+        int length = table.decodeOne(window, c);
+        if (length == 0 && windowLength >= maxLength) {
+            out.resize(start + at);
+            throw invalid_argument("Code doesn't work");
+        }
+        if (length == 0 || length > windowLength || consumed + length > limit)
+            break;
+        dst[at++] = c;
+        window >>= length;
+        windowLength -= length;
+        consumed += length;
+    }
+    out.resize(start + at);
+}
+
+SyncEncoder::SyncEncoder(const Huffman& model) : coder(model), codes(), flushed(0) {
+}
+
+void SyncEncoder::write(const uint8_t *text, size_t n) {
+    coder.write(text, n, codes);
+}
+
+void SyncEncoder::flush(string& out) {
+    uint64_t total = coder.finish(codes);
+    uint64_t bits = total - flushed;
+    flushed = total;
+    out += (char)SYNC_MARKER;
+    for (; bits >= 0x80; bits >>= 7)
+        out += (char)(uint8_t)(bits | 0x80);
+    out += (char)(uint8_t)bits;
+    out += codes;
+    codes.clear();
+}
+
+SyncDecoder::SyncDecoder(const Huffman& model) : model(model), buffered(), start(0) {
+}
+
+size_t SyncDecoder::write(const uint8_t *code, size_t n, string& out) {
+    buffered.append((const char *)code, n);
+    const uint8_t *src = (const uint8_t *)buffered.data();
+    size_t size = buffered.size();
+    size_t segments = 0;
+    while (start < size) {
+        if (src[start] != SyncEncoder::SYNC_MARKER)
+            throw invalid_argument("stream is out of sync");
+        size_t pos = start + 1;
+        uint64_t bits = 0;
+        bool whole = false;
+        for (int shift = 0; pos < size; shift += 7) {
+            if (shift >= 64)
+                throw invalid_argument("segment length is malformed");
+            uint8_t b = src[pos++];
+            bits |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) {
+                whole = true;
+                break;
+            }
+        }
+        uint64_t bytes = (bits + 7) / 8;
+        if (!whole || size - pos < bytes)
+            break;  // the rest of the segment is still on its way
+
+        // every code is at least one bit
+        size_t at = out.size();
+        out.resize(at + bits);
+        size_t decoded = 0;
+        try {
+            decoded = model.decode(src + pos, bits, (uint8_t *)&out[at], bits);
+        } catch (...) {
+            out.resize(at);
+            throw;
+        }
+        out.resize(at + decoded);
+        start = pos + bytes;
+        segments++;
+    }
+    // keep only what is left of the current segment
+    if (start == size) {
+        buffered.clear();
+        start = 0;
+    } else if (start > 4096 && start > size / 2) {
+        buffered.erase(0, start);
+        start = 0;
+    }
+    return segments;
+}
+
+#ifdef HUFFMAN_COROUTINES
+Generator<string> encodeChunks(const Huffman& model, Generator<string> input, uint64_t& bitCount) {
+    StreamEncoder encoder(model);
+    string out;
+    while (input.next()) {
+        out.clear();
+        const string& chunk = input.value();
+        encoder.write((const uint8_t *)chunk.data(), chunk.size(), out);
+        co_yield out;
+    }
+    out.clear();
+    bitCount = encoder.finish(out);
+    co_yield out;
+}
+
+Generator<string> decodeChunks(const Huffman& model, Generator<string> input, const uint64_t& bitCount) {
+    StreamDecoder decoder(model);
+    string out;
+    while (input.next()) {
+        out.clear();
+        const string& chunk = input.value();
+        decoder.write((const uint8_t *)chunk.data(), chunk.size(), out);
+        co_yield out;
+    }
+    out.clear();
+    decoder.finish(bitCount, out);
+    co_yield out;
+}
+#endif
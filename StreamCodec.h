@@ -0,0 +1,259 @@
+/**
+ * @file StreamCodec.h - Resumable Huffman coding of a stream that arrives in pieces.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Huffman.h"
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <exception>
+#include <utility>
+#define HUFFMAN_COROUTINES 1
+#endif
+
+/**
+ * @class StreamEncoder - codes text handed over a chunk at a time.
+ *
+ * Unlike Huffman::encode(), nothing blocks and nothing is read: each write() codes one chunk
+ * and hands back the whole bytes of code so far, keeping the last few bits (which may share
+ * a byte with the next chunk's codes) until the next write() or finish(). The bytes are the
+ * same as the buffer Huffman::encode() would write for all the chunks together.
+ */
+class StreamEncoder {
+public:
+    /**
+     * @param model  the Huffman codes, must outlive this object
+     */
+    explicit StreamEncoder(const Huffman& model);
+
+    /**
+     * Code a chunk of text.
+     *
+     * @param text  characters to code
+     * @param n     number of characters
+     * @param out   the whole bytes of code now available are appended to this
+     * @throws invalid_argument  if text has a character the model cannot code (then nothing
+     *                           of text is coded and the encoder is as it was)
+     */
+    void write(const uint8_t *text, size_t n, std::string& out);
+
+    /**
+     * End the stream: append the last bits, padded with zeros to a whole byte.
+     *
+     * @return  total bits of code (the decoder's finish() needs this)
+     */
+    uint64_t finish(std::string& out);
+
+    /**
+     * Bits of code so far.
+     */
+    uint64_t bitCount() const {
+        return bits;
+    }
+
+private:
+    const CodeTable& table;
+    uint64_t pending;      // bits not yet handed back, first one in the low-order bit
+    int pendingLength;     // always < 8 between calls
+    uint64_t bits;
+};
+
+/**
+ * @class StreamDecoder - decodes code bytes handed over a chunk at a time.
+ *
+ * A chunk may end in the middle of a code; the bits of it are kept until the next write().
+ * Because the zeros padding the last byte could look like codes, the last byte received is
+ * only decoded once more bytes come or finish() says where the codes end.
+ */
+class StreamDecoder {
+public:
+    /**
+     * @param model  the Huffman codes, must outlive this object
+     */
+    explicit StreamDecoder(const Huffman& model);
+
+    /**
+     * Decode as much as possible of a chunk of code.
+     *
+     * @param code  bytes of code as produced by StreamEncoder (or the buffer Huffman::encode())
+     * @param n     number of bytes
+     * @param out   the characters decoded are appended to this
+     * @throws invalid_argument  if the bits match no code
+     */
+    void write(const uint8_t *code, size_t n, std::string& out);
+
+    /**
+     * End the stream: decode the rest of the codes.
+     *
+     * @param bitCount  total bits of code, as returned by StreamEncoder::finish()
+     * @param out       the last characters are appended to this
+     * @throws invalid_argument  if bitCount doesn't match the bytes received or ends mid-code
+     */
+    void finish(uint64_t bitCount, std::string& out);
+
+private:
+    const CodeTable& table;
+    uint64_t window;       // bits received but not decoded, first one in the low-order bit
+    int windowLength;
+    bool holding;          // whether held is a byte not yet put in the window
+    uint8_t held;
+    uint64_t received;     // bytes received
+    uint64_t consumed;     // bits decoded
+
+    /**
+     * Put bytes into the window and decode every code that is complete within it.
+     * @param limit  decode no further than this many bits from the start of the stream
+     */
+    void decode(const uint8_t *code, size_t n, uint64_t limit, std::string& out);
+};
+
+/**
+ * @class SyncEncoder - codes a long-lived stream of messages so each can be decoded on arrival.
+ *
+ * A StreamEncoder's last few bits wait for the next write() or finish(), and its decoder
+ * cannot tell padding from codes until finish(), so neither end suits a connection that
+ * stays open. Here flush() ends a segment at a byte boundary and hands back all of it:
+ *     SYNC_MARKER, varint bit count (7 bits per byte, low-order group first), the codes
+ * so a SyncDecoder can decode every segment as soon as its last byte arrives, without
+ * waiting for the end of the stream. Flushing after each message costs two or three
+ * bytes; the model is the same across flushes (and is not sent).
+ */
+class SyncEncoder {
+public:
+    static const uint8_t SYNC_MARKER = 0xA5;
+
+    /**
+     * @param model  the Huffman codes, must outlive this object
+     */
+    explicit SyncEncoder(const Huffman& model);
+
+    /**
+     * Code text into the current segment (nothing is handed back until flush()).
+     *
+     * @param text  characters to code
+     * @param n     number of characters
+     * @throws invalid_argument  if text has a character the model cannot code (then none of
+     *                           text is coded and the segment is as it was)
+     */
+    void write(const uint8_t *text, size_t n);
+
+    /**
+     * End the current segment and append all of it to out, ready to send.
+     */
+    void flush(std::string& out);
+
+private:
+    StreamEncoder coder;
+    std::string codes;  // of the current segment, all but its last partial byte
+    uint64_t flushed;   // bits of code in the segments already flushed
+};
+
+/**
+ * @class SyncDecoder - decodes the segments of a SyncEncoder as their bytes arrive.
+ */
+class SyncDecoder {
+public:
+    /**
+     * @param model  the Huffman codes, must outlive this object
+     */
+    explicit SyncDecoder(const Huffman& model);
+
+    /**
+     * Take bytes as they arrive (in pieces of any size) and decode every segment they
+     * complete; the bytes of a segment not yet complete are kept for the next write().
+     *
+     * @param code  bytes received
+     * @param n     number of bytes
+     * @param out   the text of the segments completed is appended to this
+     * @return      number of segments completed
+     * @throws invalid_argument  if a segment does not start with SYNC_MARKER or its codes
+     *                           are malformed (the stream cannot be resumed after that)
+     */
+    size_t write(const uint8_t *code, size_t n, std::string& out);
+
+    /**
+     * Whether every byte received so far belongs to a completed segment.
+     */
+    bool idle() const {
+        return buffered.size() == start;
+    }
+
+private:
+    const Huffman& model;
+    std::string buffered;  // bytes received; those before start are already decoded
+    size_t start;
+};
+
+#ifdef HUFFMAN_COROUTINES
+/**
+ * @class Generator - a lazily evaluated sequence of T, produced by a coroutine with co_yield.
+ */
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        T *current = nullptr;
+        std::exception_ptr error;
+
+        Generator get_return_object() {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(T& value) noexcept {
+            current = &value;
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    explicit Generator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    Generator(Generator&& temp) noexcept : handle(std::exchange(temp.handle, nullptr)) {}
+    Generator(const Generator& other) = delete;
+    Generator& operator=(const Generator& other) = delete;
+    Generator& operator=(Generator&& temp) = delete;
+    ~Generator() {
+        if (handle)
+            handle.destroy();
+    }
+
+    /**
+     * Run the coroutine to its next co_yield.
+     * @return  false once it has finished instead
+     */
+    bool next() {
+        handle.resume();
+        if (handle.promise().error)
+            std::rethrow_exception(handle.promise().error);
+        return !handle.done();
+    }
+
+    /**
+     * The value of the last co_yield (valid until the next call to next()).
+     */
+    T& value() const {
+        return *handle.promise().current;
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * Code each chunk of text pulled from input, yielding the code bytes as they are ready.
+ * After the last chunk, bitCount is set for StreamDecoder::finish().
+ */
+Generator<std::string> encodeChunks(const Huffman& model, Generator<std::string> input, uint64_t& bitCount);
+
+/**
+ * Decode each chunk of code pulled from input, yielding the text as it is ready. bitCount is
+ * only read once input is exhausted, so it may be the one an encodeChunks() feeding input sets.
+ */
+Generator<std::string> decodeChunks(const Huffman& model, Generator<std::string> input, const uint64_t& bitCount);
+#endif
@@ -0,0 +1,201 @@
+/**
+ * @file TansCoder.cpp - Table-based asymmetric numeral system (tANS) coder.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "TansCoder.h"
+using namespace std;
+
+namespace {
+
+int highBit(uint32_t n) {
+    int bit = 0;
+    while (n >>= 1)
+        bit++;
+    return bit;
+}
+
+/*
+ * The n (up to 32) bits starting at bit pos of a buffer packed as by the encoder.
+ */
+uint32_t readBits(const uint8_t *src, size_t bytes, uint64_t pos, int n) {
+    size_t byte = (size_t)(pos / 8);
+    uint64_t w = 0;
+    memcpy(&w, src + byte, byte + 8 <= bytes ? 8 : bytes - byte);
+    return (uint32_t)((w >> (pos % 8)) & ((uint64_t(1) << n) - 1));
+}
+
+}
+
+TansCoder::TansCoder(const uint64_t frequencies[]) {
+    normalize(frequencies);
+    build();
+}
+
+TansCoder::TansCoder(const Huffman& model) {
+    uint64_t frequencies[MAX_CHAR+1];
+    for (int c = 0; c <= MAX_CHAR; c++)
+        frequencies[c] = model.getFrequency((unsigned char)c);
+    normalize(frequencies);
+    build();
+}
+
+void TansCoder::normalize(const uint64_t frequencies[]) {
+    double total = 0;
+    for (int c = 0; c <= MAX_CHAR; c++)
+        total += (double)frequencies[c];
+    if (total == 0)
+        throw invalid_argument("no characters to code");
+
+    int sum = 0;
+    for (int c = 0; c <= MAX_CHAR; c++) {
+        int slots = 0;
+        if (frequencies[c] != 0) {
+            slots = (int)((double)frequencies[c] * TABLE_SIZE / total + 0.5);
+            if (slots < 1)
+                slots = 1;
+        }
+        normalized[c] = (uint16_t)slots;
+        sum += slots;
+    }
+    // rounding (and the minimum of one slot) can miss TABLE_SIZE; the biggest counts absorb
+    // the difference, where it costs least
+    while (sum != TABLE_SIZE) {
+        int biggest = 0;
+        for (int c = 1; c <= MAX_CHAR; c++)
+            if (normalized[c] > normalized[biggest])
+                biggest = c;
+        if (sum < TABLE_SIZE) {
+            normalized[biggest]++;
+            sum++;
+        } else {
+            normalized[biggest]--;
+            sum--;
+        }
+    }
+    for (int c = 0; c <= MAX_CHAR; c++)
+        cost[c] = normalized[c] != 0 ? TABLE_LOG - log2((double)normalized[c]) : 0;
+}
+
+void TansCoder::build() {
+    // spread each character's slots over the table with an odd step, which visits every slot
+    uint8_t spread[TABLE_SIZE];
+    const int step = (TABLE_SIZE >> 1) + (TABLE_SIZE >> 3) + 3;
+    int pos = 0;
+    for (int c = 0; c <= MAX_CHAR; c++)
+        for (int i = 0; i < normalized[c]; i++) {
+            spread[pos] = (uint8_t)c;
+            pos = (pos + step) & (TABLE_SIZE - 1);
+        }
+
+    // encoding: the states of each character, in table order, after its first slot
+    int start[MAX_CHAR+1];
+    int next[MAX_CHAR+1];
+    int cumulative = 0;
+    for (int c = 0; c <= MAX_CHAR; c++) {
+        start[c] = next[c] = cumulative;
+        cumulative += normalized[c];
+    }
+    for (int i = 0; i < TABLE_SIZE; i++)
+        nextState[next[spread[i]]++] = (uint16_t)(TABLE_SIZE + i);
+    for (int c = 0; c <= MAX_CHAR; c++) {
+        int slots = normalized[c];
+        deltaFind[c] = start[c] - slots;
+        if (slots == 0) {
+            deltaBits[c] = 0;
+        } else if (slots == 1) {
+            deltaBits[c] = ((uint32_t)TABLE_LOG << 16) - TABLE_SIZE;
+        } else {
+            uint32_t maxBits = TABLE_LOG - highBit(slots - 1);
+            deltaBits[c] = (maxBits << 16) - ((uint32_t)slots << maxBits);
+        }
+    }
+
+    // decoding: slot i is the k'th slot of its character, whose state there was slots+k
+    int rank[MAX_CHAR+1];
+    for (int c = 0; c <= MAX_CHAR; c++)
+        rank[c] = normalized[c];
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        uint8_t c = spread[i];
+        uint32_t n = (uint32_t)rank[c]++;
+        int bits = TABLE_LOG - highBit(n);
+        slotTable[i].symbol = c;
+        slotTable[i].bits = (uint8_t)bits;
+        slotTable[i].base = (uint16_t)((n << bits) - TABLE_SIZE);
+    }
+}
+
+uint64_t TansCoder::predictBits(const uint64_t histogram[]) const {
+    double bits = TABLE_LOG;  // the final state
+    for (int c = 0; c <= MAX_CHAR; c++) {
+        if (histogram[c] == 0)
+            continue;
+        if (normalized[c] == 0)
+            return UINT64_MAX;
+        bits += (double)histogram[c] * cost[c];
+    }
+    return (uint64_t)ceil(bits);
+}
+
+size_t TansCoder::encodedBound(size_t n) const {
+    return (size_t)(((uint64_t)n * TABLE_LOG + TABLE_LOG + 7) / 8);
+}
+
+size_t TansCoder::encode(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const {
+    uint32_t x = TABLE_SIZE;  // any state will do to start; the decoder checks it ends here
+    uint64_t pending = 0;     // bits not yet written, the first of them least significant
+    int count = 0;
+    size_t out = 0;
+    uint64_t bitCount = 0;
+    for (size_t i = n; i-- > 0; ) {
+        uint8_t c = src[i];
+        if (normalized[c] == 0)
+            throw invalid_argument("character not in the sample: " + to_string(c));
+        uint32_t bits = (x + deltaBits[c]) >> 16;
+        pending |= (uint64_t)(x & ((1u << bits) - 1)) << count;
+        count += bits;
+        bitCount += bits;
+        x = nextState[(x >> bits) + deltaFind[c]];
+        if (count >= 32) {
+            if (out + 4 > cap)
+                throw length_error("coded buffer too small");
+            uint32_t word = (uint32_t)pending;
+            memcpy(dst + out, &word, 4);
+            out += 4;
+            pending >>= 32;
+            count -= 32;
+        }
+    }
+    pending |= (uint64_t)(x - TABLE_SIZE) << count;
+    count += TABLE_LOG;
+    bitCount += TABLE_LOG;
+    for (; count > 0; count -= 8, pending >>= 8) {
+        if (out == cap)
+            throw length_error("coded buffer too small");
+        dst[out++] = (uint8_t)pending;
+    }
+    return (size_t)bitCount;
+}
+
+void TansCoder::decode(const uint8_t *src, size_t bitCount, uint8_t *dst, size_t n) const {
+    if (bitCount < (size_t)TABLE_LOG)
+        throw invalid_argument("codes do not match the length");
+    size_t bytes = (bitCount + 7) / 8;
+    uint64_t pos = bitCount - TABLE_LOG;
+    uint32_t x = readBits(src, bytes, pos, TABLE_LOG);
+    for (size_t i = 0; i < n; i++) {
+        const Slot& slot = slotTable[x];
+        dst[i] = slot.symbol;
+        if (slot.bits > pos)
+            throw invalid_argument("codes do not match the length");
+        pos -= slot.bits;
+        x = slot.base + readBits(src, bytes, pos, slot.bits);
+    }
+    if (pos != 0 || x != 0)
+        throw invalid_argument("codes do not match the length");
+}
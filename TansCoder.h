@@ -0,0 +1,95 @@
+/**
+ * @file TansCoder.h - Table-based asymmetric numeral system (tANS) coder.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "EntropyCoder.h"
+#include "Huffman.h"
+
+/**
+ * @class TansCoder - an entropy coder that can spend fractions of a bit per character.
+ *
+ * A Huffman code spends at least one whole bit on every character, which wastes up to a
+ * bit per character when one character has most of the probability (log levels, enums,
+ * runs of padding). tANS keeps a state between characters instead and spends about
+ * log2(1/p) bits on a character of probability p, so very skewed text codes close to its
+ * entropy.
+ *
+ * The counts are normalized to TABLE_SIZE slots (each character with a non-zero count
+ * gets at least one), the slots are spread over the table as in FSE, and coding is one
+ * table lookup and one bit-field per character in each direction. The encoder works from
+ * the last character to the first and ends with its final state, so the decoder reads the
+ * bits from the end backwards and comes out with the characters in order, ending in the
+ * state the encoder started in (which is checked).
+ *
+ * Built from the same frequency table as a Huffman model, so the two can be offered side
+ * by side (see BlockCodec::Coder).
+ */
+class TansCoder : public EntropyCoder {
+public:
+    static const int MAX_CHAR = 255;
+    static const int TABLE_LOG = 12;
+    static const int TABLE_SIZE = 1 << TABLE_LOG;
+
+    /**
+     * @param frequencies  observation count of each character 0..MAX_CHAR
+     * @throws invalid_argument  if every frequency is zero
+     * @post   only characters with a non-zero frequency may be encoded
+     */
+    explicit TansCoder(const uint64_t frequencies[]);
+
+    /**
+     * Build from the frequency table of a Huffman model.
+     */
+    explicit TansCoder(const Huffman& model);
+
+    uint64_t predictBits(const uint64_t histogram[]) const override;
+    size_t encodedBound(size_t n) const override;
+    size_t encode(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) const override;
+    void decode(const uint8_t *src, size_t bitCount, uint8_t *dst, size_t n) const override;
+
+    /**
+     * Table slots of character c (0 if c cannot be coded).
+     */
+    int slots(unsigned char c) const {
+        return normalized[c];
+    }
+
+private:
+    uint16_t normalized[MAX_CHAR+1];  // slots of each character, summing to TABLE_SIZE
+    double cost[MAX_CHAR+1];          // bits per character, TABLE_LOG - log2(slots)
+
+    /*
+     * Encoding: a state x in [TABLE_SIZE, 2*TABLE_SIZE) codes character c by writing the
+     * low (x + deltaBits[c]) >> 16 bits of x, then moving to
+     * nextState[(x >> those bits) + deltaFind[c]].
+     */
+    uint32_t deltaBits[MAX_CHAR+1];
+    int32_t deltaFind[MAX_CHAR+1];
+    uint16_t nextState[TABLE_SIZE];
+
+    /*
+     * Decoding: state x in [0, TABLE_SIZE) is character symbol; the next state is base plus
+     * the next bits bits (read backwards).
+     */
+    struct Slot {
+        uint16_t base;
+        uint8_t symbol;
+        uint8_t bits;
+    };
+    Slot slotTable[TABLE_SIZE];
+
+    /**
+     * Scale the counts so they sum to TABLE_SIZE, keeping every non-zero count non-zero.
+     */
+    void normalize(const uint64_t frequencies[]);
+
+    /**
+     * Spread the characters over the table and build both directions' tables.
+     */
+    void build();
+};
@@ -0,0 +1,86 @@
+/**
+ * @file WorkStealingPool.cpp - A fixed set of worker threads that steal work from each other.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#include "WorkStealingPool.h"
+using namespace std;
+
+namespace {
+
+// the pool and worker the calling thread belongs to, if it is a worker
+thread_local const WorkStealingPool *currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+}
+
+WorkStealingPool::WorkStealingPool(int threads) : queued(0), nextWorker(0), stopping(false) {
+    if (threads <= 0)
+        threads = max((int)thread::hardware_concurrency(), 1);
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(new Worker());
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i]->thread = thread(&WorkStealingPool::run, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard<mutex> guard(idleLock);
+        stopping = true;
+    }
+    idle.notify_all();
+    for (auto& worker: workers)
+        worker->thread.join();
+}
+
+void WorkStealingPool::submit(Task task) {
+    size_t target = currentPool == this ? currentWorker
+                                        : nextWorker.fetch_add(1, memory_order_relaxed) % workers.size();
+    // counted before it is queued, so queued never goes negative when it is taken at once
+    {
+        lock_guard<mutex> guard(idleLock);
+        queued.fetch_add(1);
+    }
+    {
+        lock_guard<mutex> guard(workers[target]->lock);
+        workers[target]->tasks.push_back(move(task));
+    }
+    idle.notify_one();
+}
+
+bool WorkStealingPool::take(size_t self, Task& task) {
+    for (size_t k = 0; k < workers.size(); k++) {
+        Worker& victim = *workers[(self + k) % workers.size()];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(size_t self) {
+    currentPool = this;
+    currentWorker = self;
+    Task task;
+    for (;;) {
+        if (take(self, task)) {
+            try {
+                task();
+            } catch (...) {
+                // a task's errors are its own to report
+            }
+            task = nullptr;
+            continue;
+        }
+        unique_lock<mutex> guard(idleLock);
+        if (stopping && queued.load() == 0)
+            return;
+        // a task counted but not yet pushed wakes us straight back up to look again
+        idle.wait(guard, [this]() { return queued.load() > 0 || stopping; });
+    }
+}
@@ -0,0 +1,96 @@
+/**
+ * @file WorkStealingPool.h - A fixed set of worker threads that steal work from each other.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class WorkStealingPool - runs submitted tasks on a fixed number of threads.
+ *
+ * Each worker has its own queue. Tasks submitted from outside the pool are dealt out to
+ * the queues in turn; tasks submitted by a running task go on its own worker's queue. A
+ * worker runs its own tasks oldest first, and once its queue is empty it steals the oldest
+ * task from the other workers' queues, so one long task only holds up the tasks behind it
+ * until some other worker runs out of work. Taking the oldest task everywhere keeps the
+ * wait of any one task from growing with the number of tasks submitted after it.
+ *
+ * Tasks must not throw; anything that escapes one is discarded.
+ */
+class WorkStealingPool {
+public:
+    typedef std::function<void()> Task;
+
+    /**
+     * Start the workers.
+     *
+     * @param threads  number of workers; 0 for one per hardware thread
+     */
+    explicit WorkStealingPool(int threads = 0);
+
+    /**
+     * Run every task already submitted, then stop the workers.
+     */
+    ~WorkStealingPool();
+
+    // big 5 (owns threads, so neither copying nor moving is allowed)
+    WorkStealingPool(const WorkStealingPool& other) = delete;
+    WorkStealingPool(WorkStealingPool&& temp) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool& other) = delete;
+    WorkStealingPool& operator=(WorkStealingPool&& temp) = delete;
+
+    /**
+     * Queue a task to be run on one of the workers. Safe to call from any thread.
+     */
+    void submit(Task task);
+
+    /**
+     * Number of tasks submitted that no worker has started yet.
+     */
+    size_t queueDepth() const {
+        return (size_t)queued.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Number of worker threads.
+     */
+    int threads() const {
+        return (int)workers.size();
+    }
+
+private:
+    struct Worker {
+        std::mutex lock;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<long long> queued;      // submitted and not yet taken by a worker
+    std::atomic<size_t> nextWorker;     // where the next outside submission goes
+    std::mutex idleLock;
+    std::condition_variable idle;       // signalled when queued goes up or on shutdown
+    bool stopping;                      // guarded by idleLock
+
+    /**
+     * Worker self's loop: run tasks until the pool is stopping and no task is left.
+     */
+    void run(size_t self);
+
+    /**
+     * Take the oldest task from worker self's queue, or failing that from another's.
+     *
+     * @return  false if every queue was empty
+     */
+    bool take(size_t self, Task& task);
+};
@@ -0,0 +1,551 @@
+/**
+ * @file QueueRing.h - Bounded lock-free ring buffers implementing the Queue ADT.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC 2430, Spring 2018"
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "adt/Queue.h"
+
+namespace QueueRingDetail {
+
+/**
+ * Bytes between data written by different threads, so they never share a cache line.
+ */
+static const size_t CACHE_LINE = 64;
+
+/**
+ * Smallest power of two that is at least capacity (and at least 2).
+ */
+inline size_t roundUp(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+        if (size > SIZE_MAX / 2)
+            throw std::length_error("queue capacity too large");
+        size *= 2;
+    }
+    return size;
+}
+
+/**
+ * Room for one T, constructed and destroyed by the queue.
+ */
+template <typename T>
+struct Storage {
+    alignas(T) unsigned char bytes[sizeof(T)];
+
+    T *get() {
+        return reinterpret_cast<T *>(bytes);
+    }
+
+    const T *get() const {
+        return reinterpret_cast<const T *>(bytes);
+    }
+};
+
+/**
+ * Copy datum into where, for the Queue ADT's enqueue() (which takes a const T&).
+ * A move-only T cannot be copied, so it has to go through try_enqueue(T&&) instead.
+ */
+template <typename T>
+void copyInto(void *where, const T& datum, std::true_type) {
+    new (where) T(datum);
+}
+
+template <typename T>
+void copyInto(void *, const T&, std::false_type) {
+    throw std::logic_error("enqueue() copies its argument; move this type in with try_enqueue()");
+}
+
+/**
+ * Print one element for the Queue ADT's print(), or "?" for a T without operator<<.
+ */
+template <typename T>
+auto printOne(std::ostream& out, const T& datum, int) -> decltype(out << datum, void()) {
+    out << datum << " ";
+}
+
+template <typename T>
+void printOne(std::ostream& out, const T&, long) {
+    out << "? ";
+}
+
+}
+
+/**
+ * @class QueueSPSC - Implementation of Queue ADT as a bounded ring for exactly one
+ * producer thread and one consumer thread, with no locks.
+ *
+ * Each side owns one index, written by it alone, and keeps its last view of the other
+ * side's index, so a hand-off touches the other side's cache line only when the ring
+ * looks full (or empty) from where it stands. The two indexes are a cache line apart.
+ * Nothing is allocated after construction.
+ *
+ * Only the producer may call try_enqueue() and enqueue(); only the consumer may call
+ * try_dequeue(), peek(), dequeue(), empty() and clear(); print() needs the producer to
+ * be idle. A full ring never blocks: try_enqueue() returns false and enqueue() throws,
+ * so callers choose how to wait (see Pipeline's Channel).
+ *
+ * @tparam T  data element type, needs only a move constructor (and a copy constructor
+ *            for enqueue(), and operator<< for print() to show it)
+ */
+template <typename T>
+class QueueSPSC : public Queue<T> {
+public:
+    static const size_t DEFAULT_CAPACITY = 1024;
+
+    /**
+     * @param capacity  most elements held at once (rounded up to a power of two)
+     */
+    explicit QueueSPSC(size_t capacity = DEFAULT_CAPACITY);
+    ~QueueSPSC();
+
+    // not copyable or movable: the two threads each hold on to it
+    QueueSPSC(const QueueSPSC<T>& other) = delete;
+    QueueSPSC(QueueSPSC<T>&& temp) = delete;
+    QueueSPSC<T>& operator=(const QueueSPSC<T>& other) = delete;
+    QueueSPSC<T>& operator=(QueueSPSC<T>&& temp) = delete;
+
+    /**
+     * Add an element if there is room (producer only).
+     *
+     * Efficiency: O(1), no locks
+     * @param datum  moved into the queue, only if this returns true
+     * @return       false if the queue is full
+     */
+    bool try_enqueue(T&& datum);
+
+    /**
+     * Add a copy of an element if there is room (producer only).
+     * @return  false if the queue is full
+     */
+    bool try_enqueue(const T& datum);
+
+    /**
+     * Remove the oldest element if there is one (consumer only).
+     *
+     * Efficiency: O(1), no locks
+     * @param datum  receives the element, moved out of the queue
+     * @return       false if the queue is empty
+     */
+    bool try_dequeue(T& datum);
+
+    /**
+     * Most elements held at once.
+     */
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+    const T& peek() const;
+    /**
+     * @throws length_error  if the queue is full
+     * @throws logic_error   if T cannot be copied (use try_enqueue(T&&))
+     */
+    void enqueue(const T& datum);
+    void dequeue();
+    bool empty() const;
+    void clear();
+    std::ostream& print(std::ostream& out) const;
+
+private:
+    typedef QueueRingDetail::Storage<T> Slot;
+
+    size_t mask;
+    Slot *slots;
+    char padHead[QueueRingDetail::CACHE_LINE];
+    std::atomic<size_t> head;     // next element to dequeue, written by the consumer
+    mutable size_t tailSeen;      // consumer's last view of tail
+    char padTail[QueueRingDetail::CACHE_LINE];
+    std::atomic<size_t> tail;     // next slot to fill, written by the producer
+    size_t headSeen;              // producer's last view of head
+    char padEnd[QueueRingDetail::CACHE_LINE];
+
+    /**
+     * The slot for index i, if one is free (producer), else nullptr.
+     */
+    void *reserve(size_t i);
+
+    /**
+     * The element at index i, if there is one (consumer), else nullptr.
+     */
+    T *front(size_t i) const;
+};
+
+template <typename T>
+QueueSPSC<T>::QueueSPSC(size_t capacity)
+        : mask(QueueRingDetail::roundUp(capacity) - 1), slots(new Slot[mask + 1]), head(0), tailSeen(0),
+          tail(0), headSeen(0) {
+}
+
+template <typename T>
+QueueSPSC<T>::~QueueSPSC() {
+    clear();
+    delete[] slots;
+}
+
+template <typename T>
+void *QueueSPSC<T>::reserve(size_t i) {
+    if (i - headSeen > mask) {
+        headSeen = head.load(std::memory_order_acquire);
+        if (i - headSeen > mask)
+            return nullptr;
+    }
+    return slots[i & mask].bytes;
+}
+
+template <typename T>
+T *QueueSPSC<T>::front(size_t i) const {
+    if (i == tailSeen) {
+        tailSeen = tail.load(std::memory_order_acquire);
+        if (i == tailSeen)
+            return nullptr;
+    }
+    return slots[i & mask].get();
+}
+
+template <typename T>
+bool QueueSPSC<T>::try_enqueue(T&& datum) {
+    size_t i = tail.load(std::memory_order_relaxed);
+    void *where = reserve(i);
+    if (where == nullptr)
+        return false;
+    new (where) T(std::move(datum));
+    tail.store(i + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool QueueSPSC<T>::try_enqueue(const T& datum) {
+    size_t i = tail.load(std::memory_order_relaxed);
+    void *where = reserve(i);
+    if (where == nullptr)
+        return false;
+    new (where) T(datum);
+    tail.store(i + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool QueueSPSC<T>::try_dequeue(T& datum) {
+    size_t i = head.load(std::memory_order_relaxed);
+    T *element = front(i);
+    if (element == nullptr)
+        return false;
+    datum = std::move(*element);
+    element->~T();
+    head.store(i + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+const T& QueueSPSC<T>::peek() const {
+    T *element = front(head.load(std::memory_order_relaxed));
+    if (element == nullptr)
+        throw std::out_of_range("peek on an empty queue");
+    return *element;
+}
+
+template <typename T>
+void QueueSPSC<T>::enqueue(const T& datum) {
+    size_t i = tail.load(std::memory_order_relaxed);
+    void *where = reserve(i);
+    if (where == nullptr)
+        throw std::length_error("enqueue on a full queue");
+    QueueRingDetail::copyInto(where, datum, typename std::is_copy_constructible<T>::type());
+    tail.store(i + 1, std::memory_order_release);
+}
+
+template <typename T>
+void QueueSPSC<T>::dequeue() {
+    size_t i = head.load(std::memory_order_relaxed);
+    T *element = front(i);
+    if (element == nullptr)
+        throw std::out_of_range("dequeue on an empty queue");
+    element->~T();
+    head.store(i + 1, std::memory_order_release);
+}
+
+template <typename T>
+bool QueueSPSC<T>::empty() const {
+    return front(head.load(std::memory_order_relaxed)) == nullptr;
+}
+
+template <typename T>
+void QueueSPSC<T>::clear() {
+    while (!empty())
+        dequeue();
+}
+
+template <typename T>
+std::ostream& QueueSPSC<T>::print(std::ostream& out) const {
+    size_t end = tail.load(std::memory_order_acquire);
+    for (size_t i = head.load(std::memory_order_relaxed); i != end; i++)
+        QueueRingDetail::printOne(out, *slots[i & mask].get(), 0);
+    return out;
+}
+
+/**
+ * @class QueueMPMC - Implementation of Queue ADT as a bounded ring for any number of
+ * producer and consumer threads, with no locks.
+ *
+ * Each slot carries a sequence number that says whose turn it is (Vyukov's bounded
+ * queue): a producer claims the tail index with one compare-and-swap once the slot's
+ * number shows the last element there has been taken, and publishes its element by
+ * advancing the number; consumers do the same at the head. Threads only contend on the
+ * index they share, never on a lock, and a thread stalled mid-hand-off holds up only its
+ * own slot.
+ *
+ * Every method may be called from any thread, but peek() and print() are only meaningful
+ * while no other thread dequeues, and empty() is a snapshot.
+ *
+ * @tparam T  data element type, needs only a move constructor (and a copy constructor
+ *            for enqueue(), and operator<< for print() to show it)
+ */
+template <typename T>
+class QueueMPMC : public Queue<T> {
+public:
+    static const size_t DEFAULT_CAPACITY = 1024;
+
+    /**
+     * @param capacity  most elements held at once (rounded up to a power of two)
+     */
+    explicit QueueMPMC(size_t capacity = DEFAULT_CAPACITY);
+    ~QueueMPMC();
+
+    // not copyable or movable: other threads hold on to it
+    QueueMPMC(const QueueMPMC<T>& other) = delete;
+    QueueMPMC(QueueMPMC<T>&& temp) = delete;
+    QueueMPMC<T>& operator=(const QueueMPMC<T>& other) = delete;
+    QueueMPMC<T>& operator=(QueueMPMC<T>&& temp) = delete;
+
+    /**
+     * Add an element if there is room.
+     *
+     * Efficiency: O(1), lock-free
+     * @param datum  moved into the queue, only if this returns true
+     * @return       false if the queue is full
+     */
+    bool try_enqueue(T&& datum);
+
+    /**
+     * Add a copy of an element if there is room.
+     * @return  false if the queue is full
+     */
+    bool try_enqueue(const T& datum);
+
+    /**
+     * Remove the oldest element if there is one.
+     *
+     * Efficiency: O(1), lock-free
+     * @param datum  receives the element, moved out of the queue
+     * @return       false if the queue is empty
+     */
+    bool try_dequeue(T& datum);
+
+    /**
+     * Most elements held at once.
+     */
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+    const T& peek() const;
+    /**
+     * @throws length_error  if the queue is full
+     * @throws logic_error   if T cannot be copied (use try_enqueue(T&&))
+     */
+    void enqueue(const T& datum);
+    void dequeue();
+    bool empty() const;
+    void clear();
+    std::ostream& print(std::ostream& out) const;
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;  // i: free for index i; i+1: holds index i's element
+        QueueRingDetail::Storage<T> storage;
+    };
+
+    size_t mask;
+    Cell *cells;
+    char padHead[QueueRingDetail::CACHE_LINE];
+    std::atomic<size_t> head;  // next index to dequeue
+    char padTail[QueueRingDetail::CACHE_LINE];
+    std::atomic<size_t> tail;  // next index to fill
+    char padEnd[QueueRingDetail::CACHE_LINE];
+
+    /**
+     * Claim the cell for the next index to fill.
+     * @return  the cell (its index in i), or nullptr if the queue is full
+     */
+    Cell *claimTail(size_t& i);
+
+    /**
+     * Claim the cell for the next index to dequeue.
+     * @return  the cell (its index in i), or nullptr if the queue is empty
+     */
+    Cell *claimHead(size_t& i);
+
+    /**
+     * Destroy a claimed cell's element and free the cell for the next lap.
+     */
+    void release(Cell *cell, size_t i);
+
+    /**
+     * enqueue() for a T that can be copied, and for one that cannot.
+     */
+    void enqueueCopy(const T& datum, std::true_type);
+    void enqueueCopy(const T& datum, std::false_type);
+};
+
+template <typename T>
+QueueMPMC<T>::QueueMPMC(size_t capacity)
+        : mask(QueueRingDetail::roundUp(capacity) - 1), cells(new Cell[mask + 1]), head(0), tail(0) {
+    for (size_t i = 0; i <= mask; i++)
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <typename T>
+QueueMPMC<T>::~QueueMPMC() {
+    clear();
+    delete[] cells;
+}
+
+template <typename T>
+typename QueueMPMC<T>::Cell *QueueMPMC<T>::claimTail(size_t& i) {
+    i = tail.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell *cell = &cells[i & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t lap = (intptr_t)sequence - (intptr_t)i;
+        if (lap == 0) {
+            if (tail.compare_exchange_weak(i, i + 1, std::memory_order_relaxed))
+                return cell;
+        } else if (lap < 0) {
+            return nullptr;  // still holds the element from the last lap
+        } else {
+            i = tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename T>
+typename QueueMPMC<T>::Cell *QueueMPMC<T>::claimHead(size_t& i) {
+    i = head.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell *cell = &cells[i & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t lap = (intptr_t)sequence - (intptr_t)(i + 1);
+        if (lap == 0) {
+            if (head.compare_exchange_weak(i, i + 1, std::memory_order_relaxed))
+                return cell;
+        } else if (lap < 0) {
+            return nullptr;  // not filled yet
+        } else {
+            i = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename T>
+void QueueMPMC<T>::release(Cell *cell, size_t i) {
+    cell->storage.get()->~T();
+    cell->sequence.store(i + mask + 1, std::memory_order_release);
+}
+
+template <typename T>
+bool QueueMPMC<T>::try_enqueue(T&& datum) {
+    size_t i;
+    Cell *cell = claimTail(i);
+    if (cell == nullptr)
+        return false;
+    new (cell->storage.bytes) T(std::move(datum));
+    cell->sequence.store(i + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool QueueMPMC<T>::try_enqueue(const T& datum) {
+    T copy(datum);
+    return try_enqueue(std::move(copy));
+}
+
+template <typename T>
+bool QueueMPMC<T>::try_dequeue(T& datum) {
+    size_t i;
+    Cell *cell = claimHead(i);
+    if (cell == nullptr)
+        return false;
+    datum = std::move(*cell->storage.get());
+    release(cell, i);
+    return true;
+}
+
+template <typename T>
+const T& QueueMPMC<T>::peek() const {
+    size_t i = head.load(std::memory_order_relaxed);
+    const Cell& cell = cells[i & mask];
+    if (cell.sequence.load(std::memory_order_acquire) != i + 1)
+        throw std::out_of_range("peek on an empty queue");
+    return *cell.storage.get();
+}
+
+template <typename T>
+void QueueMPMC<T>::enqueue(const T& datum) {
+    enqueueCopy(datum, typename std::is_copy_constructible<T>::type());
+}
+
+template <typename T>
+void QueueMPMC<T>::enqueueCopy(const T& datum, std::true_type) {
+    // copied before an index is claimed: once claimed, it has to be filled
+    T copy(datum);
+    if (!try_enqueue(std::move(copy)))
+        throw std::length_error("enqueue on a full queue");
+}
+
+template <typename T>
+void QueueMPMC<T>::enqueueCopy(const T&, std::false_type) {
+    throw std::logic_error("enqueue() copies its argument; move this type in with try_enqueue()");
+}
+
+template <typename T>
+void QueueMPMC<T>::dequeue() {
+    size_t i;
+    Cell *cell = claimHead(i);
+    if (cell == nullptr)
+        throw std::out_of_range("dequeue on an empty queue");
+    release(cell, i);
+}
+
+template <typename T>
+bool QueueMPMC<T>::empty() const {
+    size_t i = head.load(std::memory_order_relaxed);
+    return cells[i & mask].sequence.load(std::memory_order_acquire) != i + 1;
+}
+
+template <typename T>
+void QueueMPMC<T>::clear() {
+    size_t i;
+    Cell *cell;
+    while ((cell = claimHead(i)) != nullptr)
+        release(cell, i);
+}
+
+template <typename T>
+std::ostream& QueueMPMC<T>::print(std::ostream& out) const {
+    size_t end = tail.load(std::memory_order_acquire);
+    for (size_t i = head.load(std::memory_order_relaxed); i != end; i++) {
+        const Cell& cell = cells[i & mask];
+        if (cell.sequence.load(std::memory_order_acquire) == i + 1)
+            QueueRingDetail::printOne(out, *cell.storage.get(), 0);
+    }
+    return out;
+}
@@ -0,0 +1,356 @@
+/**
+ * @file huff.cpp - Command-line compressor built on BlockCodec/Pipeline and BlockSort.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ *
+ * usage: huff [-d] [options] [input [output]]     ("-" or nothing means stdin/stdout)
+ */
+
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "BlockCodec.h"
+#include "BlockSort.h"
+#include "FrequencySampler.h"
+#include "ModelSet.h"
+#include "Pipeline.h"
+
+using namespace std;
+
+namespace {
+
+/*
+ * File layout: FileHeader, then
+ *     FRAMES:     [model frequencies unless EXTERNAL_MODEL], BlockCodec frames, end marker
+ *     BLOCK_SORT: BlockSort blocks
+ */
+const char MAGIC[4] = {'H', 'U', 'F', 'F'};
+
+enum Method : uint8_t {
+    FRAMES = 0,     // level 1: Huffman frames through the three-stage pipeline
+    BLOCK_SORT = 1  // levels 2-9: BWT + move-to-front + zero runs, then Huffman
+};
+
+enum Flags : uint8_t {
+    EXTERNAL_MODEL = 1  // frames were coded with a --model file that is not in the stream
+};
+
+struct FileHeader {
+    char magic[4];
+    uint8_t method;  // a Method
+    uint8_t flags;   // Flags
+    uint16_t unused; // zero
+};
+
+const size_t MAX_BLOCK_SIZE = 256 * 1024 * 1024;
+
+struct Options {
+    bool decompress = false;
+    int threads = 1;
+    size_t blockSize = 0;  // 0 for the level's default
+    int level = 1;
+    string model;
+    BlockCodec::Coder coder = BlockCodec::USE_HUFFMAN;
+    bool verify = false;
+    bool bench = false;
+    string input = "-";
+    string output = "-";
+};
+
+void usage(const char *program) {
+    cerr << "usage: " << program << " [-d] [options] [input [output]]" << endl
+         << "  -c, --compress         compress (the default)" << endl
+         << "  -d, --decompress       decompress" << endl
+         << "  -t, --threads N        blocks sorted (or with -d, unsorted) at the same time at levels" << endl
+         << "                         2-9 (default 1); level 1 always codes on its own three threads" << endl
+         << "  -b, --block-size N[K|M] bytes per block (default 64K at level 1, level x 100K above)" << endl
+         << "  -l, --level N          1 for fast Huffman frames, 2-9 for block sorting (default 1)" << endl
+         << "  -m, --model FILE       code level 1 frames with a model set saved by train" << endl
+         << "  -e, --entropy CODER    huffman, ans or best: level 1 frames' coder (default huffman)" << endl
+         << "      --verify           decode in memory and compare, writing no output" << endl
+         << "      --bench            print sizes and throughput, writing no output" << endl
+         << "input and output default to stdin and stdout (also \"-\")" << endl;
+}
+
+size_t parseSize(const string& text) {
+    char *end;
+    errno = 0;
+    unsigned long long n = strtoull(text.c_str(), &end, 10);
+    unsigned long long unit = 1;
+    if (*end == 'K' || *end == 'k')
+        unit = 1024, end++;
+    else if (*end == 'M' || *end == 'm')
+        unit = 1024 * 1024, end++;
+    // checked before multiplying, so a huge count cannot wrap round to a small size
+    if (!isdigit((unsigned char)text[0]) || errno == ERANGE || *end != '\0' || n == 0 ||
+        n > MAX_BLOCK_SIZE / unit)
+        throw invalid_argument("bad block size " + text);
+    return (size_t)(n * unit);
+}
+
+int parseInt(const string& text, int lo, int hi, const string& what) {
+    char *end;
+    long n = strtol(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0' || n < lo || n > hi)
+        throw invalid_argument("bad " + what + " " + text);
+    return (int)n;
+}
+
+BlockCodec::Coder parseCoder(const string& text) {
+    if (text == "huffman")
+        return BlockCodec::USE_HUFFMAN;
+    if (text == "ans")
+        return BlockCodec::USE_ANS;
+    if (text == "best")
+        return BlockCodec::USE_BEST;
+    throw invalid_argument("bad entropy coder " + text);
+}
+
+Options parseArgs(int argc, char *argv[]) {
+    Options opts;
+    int files = 0;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        auto value = [&]() -> string {
+            if (i + 1 >= argc)
+                throw invalid_argument(arg + " needs a value");
+            return argv[++i];
+        };
+        if (arg == "-c" || arg == "--compress")
+            opts.decompress = false;
+        else if (arg == "-d" || arg == "--decompress")
+            opts.decompress = true;
+        else if (arg == "-t" || arg == "--threads")
+            opts.threads = parseInt(value(), 1, 1024, "thread count");
+        else if (arg == "-b" || arg == "--block-size")
+            opts.blockSize = parseSize(value());
+        else if (arg == "-l" || arg == "--level")
+            opts.level = parseInt(value(), 1, 9, "level");
+        else if (arg == "-m" || arg == "--model")
+            opts.model = value();
+        else if (arg == "-e" || arg == "--entropy")
+            opts.coder = parseCoder(value());
+        else if (arg == "--verify")
+            opts.verify = true;
+        else if (arg == "--bench")
+            opts.bench = true;
+        else if (arg.size() > 1 && arg[0] == '-')
+            throw invalid_argument("unknown option " + arg);
+        else if (files == 0)
+            opts.input = arg, files++;
+        else if (files == 1)
+            opts.output = arg, files++;
+        else
+            throw invalid_argument("too many file names");
+    }
+    // level 1 overlaps reading, coding and writing on a fixed three threads
+    if (!opts.decompress && opts.level == 1 && opts.threads > 1)
+        throw invalid_argument("--threads only applies at levels 2-9");
+    if (opts.blockSize == 0)
+        opts.blockSize = opts.level == 1 ? Pipeline::DEFAULT_BLOCK_SIZE : opts.level * 100 * 1000;
+    return opts;
+}
+
+void compress(const Options& opts, istream& in, ostream& out) {
+    FileHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    if (opts.level > 1) {
+        header.method = BLOCK_SORT;
+        out.write((const char *)&header, sizeof(header));
+        BlockSort(opts.blockSize, opts.threads).compress(in, out);
+        return;
+    }
+
+    header.method = FRAMES;
+    if (!opts.model.empty()) {
+        ModelSet models(opts.model);
+        header.flags = EXTERNAL_MODEL;
+        out.write((const char *)&header, sizeof(header));
+        BlockCodec codec(models, BlockCodec::DEFAULT_MIN_SAVINGS, CompressibilityProbe::DEFAULT_SAMPLE_SIZE, true,
+                         opts.coder);
+        Pipeline(codec, opts.blockSize).compress(in, out);
+        return;
+    }
+
+    // no model given: build one (every character allowed) and store it; a file is sampled
+    // all the way through, a pipe is modelled on its first block
+    string first;
+    uint64_t frequencies[Huffman::MAX_CHAR+1];
+    if (FrequencySampler::seekable(in)) {
+        FrequencySampler().count(in, frequencies);
+    } else {
+        first.resize(opts.blockSize);
+        in.read(&first[0], first.size());
+        first.resize(in.gcount());
+        for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+            frequencies[c] = 0;
+        for (char c: first)
+            frequencies[(unsigned char)c]++;
+    }
+    FrequencySampler::reserve(frequencies);
+    ModelSet models;
+    models.add(frequencies);
+    out.write((const char *)&header, sizeof(header));
+    models.get(0).writeFrequencies(out);
+
+    BlockCodec codec(models, BlockCodec::DEFAULT_MIN_SAVINGS, CompressibilityProbe::DEFAULT_SAMPLE_SIZE, true,
+                     opts.coder);
+    if (!first.empty()) {
+        string frame;
+        codec.encode(first, frame);
+        out.write(frame.data(), frame.size());
+    }
+    Pipeline(codec, opts.blockSize).compress(in, out);
+}
+
+void decompress(const Options& opts, istream& in, ostream& out) {
+    FileHeader header;
+    if (!in.read((char *)&header, sizeof(header)) || memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        throw invalid_argument("input is not a huff stream");
+    if (header.method == BLOCK_SORT) {
+        BlockSort(opts.blockSize, opts.threads).decompress(in, out);
+        return;
+    }
+    if (header.method != FRAMES)
+        throw invalid_argument("unknown huff method " + to_string(header.method));
+
+    unique_ptr<ModelSet> models;
+    if (header.flags & EXTERNAL_MODEL) {
+        if (opts.model.empty())
+            throw invalid_argument("input was compressed with a model file, use --model");
+        models.reset(new ModelSet(opts.model));
+    } else {
+        models.reset(new ModelSet());
+        uint64_t frequencies[Huffman::MAX_CHAR+1];
+        Huffman::readFrequencies(in, frequencies);
+        models->add(frequencies);
+    }
+    // decodes frames of either coder, building tANS tables only if an ANS frame comes
+    BlockCodec codec(*models);
+    Pipeline(codec).decompress(in, out);
+}
+
+/*
+ * An output stream buffer that keeps nothing, just counts.
+ */
+class CountingBuf : public streambuf {
+public:
+    uint64_t count = 0;
+
+protected:
+    int overflow(int c) override {
+        count++;
+        return c == EOF ? 0 : c;
+    }
+
+    streamsize xsputn(const char *, streamsize n) override {
+        count += n;
+        return n;
+    }
+};
+
+double seconds(chrono::steady_clock::time_point since) {
+    return chrono::duration<double>(chrono::steady_clock::now() - since).count();
+}
+
+double rate(uint64_t bytes, double secs) {
+    return bytes / 1e6 / (secs > 0 ? secs : 1e-9);
+}
+
+/*
+ * --verify and --bench: everything happens in memory and nothing is written.
+ */
+int check(const Options& opts, istream& in) {
+    stringstream source;
+    source << in.rdbuf();
+    string original = source.str();
+    cout << fixed << setprecision(1);
+
+    if (opts.decompress) {
+        CountingBuf sink;
+        ostream out(&sink);
+        auto start = chrono::steady_clock::now();
+        decompress(opts, source, out);
+        double secs = seconds(start);
+        cout << original.size() << " bytes decoded to " << sink.count << " bytes, all checks passed";
+        if (opts.bench)
+            cout << " (" << rate(sink.count, secs) << " MB/s)";
+        cout << endl;
+        return 0;
+    }
+
+    stringstream coded;
+    auto start = chrono::steady_clock::now();
+    compress(opts, source, coded);
+    double compressSecs = seconds(start);
+    ostringstream decoded;
+    start = chrono::steady_clock::now();
+    decompress(opts, coded, decoded);
+    double decompressSecs = seconds(start);
+
+    bool same = decoded.str() == original;
+    uint64_t codedSize = coded.str().size();
+    cout << original.size() << " -> " << codedSize << " bytes";
+    if (!original.empty())
+        cout << " (" << 100.0 * codedSize / original.size() << "%)";
+    if (opts.bench)
+        cout << ", compress " << rate(original.size(), compressSecs) << " MB/s"
+             << ", decompress " << rate(original.size(), decompressSecs) << " MB/s";
+    cout << (same ? ", verified" : ", MISMATCH") << endl;
+    return same ? 0 : 1;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    ios::sync_with_stdio(false);
+    Options opts;
+    try {
+        opts = parseArgs(argc, argv);
+    } catch (const invalid_argument& e) {
+        cerr << argv[0] << ": " << e.what() << endl;
+        usage(argv[0]);
+        return 2;
+    }
+
+    try {
+        ifstream inFile;
+        if (opts.input != "-") {
+            inFile.open(opts.input, ios::binary);
+            if (!inFile)
+                throw invalid_argument("cannot read " + opts.input);
+        }
+        istream& in = opts.input != "-" ? inFile : cin;
+
+        if (opts.verify || opts.bench)
+            return check(opts, in);
+
+        ofstream outFile;
+        if (opts.output != "-") {
+            outFile.open(opts.output, ios::binary);
+            if (!outFile)
+                throw invalid_argument("cannot write " + opts.output);
+        }
+        ostream& out = opts.output != "-" ? outFile : cout;
+        if (opts.decompress)
+            decompress(opts, in, out);
+        else
+            compress(opts, in, out);
+        out.flush();
+        if (!out)
+            throw runtime_error("cannot write output");
+    } catch (const exception& e) {
+        cerr << argv[0] << ": " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file tests/bench_queues.cpp - Hand-offs per second through QueueSPSC, QueueMPMC and a
+ *       QueueL behind a mutex.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC 2430, Spring 2018"
+ *
+ * Each run moves a fixed number of values from producer threads to consumer threads
+ * through a queue of 1024 slots and reports the rate. The locked QueueL is what a bounded
+ * queue costs with the ADTs alone (one lock around every enqueue and dequeue), the same
+ * scheme Pipeline's channels used before QueueSPSC. Every run also checks what arrived:
+ * in order for one producer, by sum for several, so the benchmark doubles as a test and
+ * exits non-zero if a value is lost.
+ *
+ * usage: bench_queues [handoffs [pairs]]
+ * pairs is the number of producers (and of consumers) in the many-thread runs, by default
+ * half the hardware threads. On a single core every thread that finds the queue full or
+ * empty yields, so the rates there mostly measure the scheduler; run it on a machine with
+ * at least 2 x pairs cores for numbers worth comparing.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "adts/QueueL.h"
+#include "adts/QueueRing.h"
+using namespace std;
+
+namespace {
+
+const size_t CAPACITY = 1024;
+
+/*
+ * QueueL bounded to CAPACITY, with a lock around each operation.
+ */
+class LockedQueue {
+public:
+    bool try_enqueue(long&& datum) {
+        lock_guard<mutex> lock(m);
+        if (count == CAPACITY)
+            return false;
+        q.enqueue(datum);
+        count++;
+        return true;
+    }
+
+    bool try_dequeue(long& datum) {
+        lock_guard<mutex> lock(m);
+        if (count == 0)
+            return false;
+        datum = q.peek();
+        q.dequeue();
+        count--;
+        return true;
+    }
+
+private:
+    QueueL<long> q;
+    mutex m;
+    size_t count = 0;
+};
+
+int failures = 0;
+
+/*
+ * Move values 1..perProducer from each of producers threads to consumers threads.
+ * @return  hand-offs per second
+ */
+template <typename Q>
+double run(Q& q, int producers, int consumers, long perProducer) {
+    long total = producers * perProducer;
+    atomic<long> received(0), sum(0);
+    atomic<bool> ordered(true);
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for (int p = 0; p < producers; p++)
+        threads.emplace_back([&]() {
+            for (long i = 1; i <= perProducer; ) {
+                long value = i;
+                if (q.try_enqueue(std::move(value)))
+                    i++;
+                else
+                    this_thread::yield();
+            }
+        });
+    for (int c = 0; c < consumers; c++)
+        threads.emplace_back([&]() {
+            long value, last = 0, mine = 0;
+            while (received.load(memory_order_relaxed) < total) {
+                if (!q.try_dequeue(value)) {
+                    this_thread::yield();
+                    continue;
+                }
+                if (producers == 1 && consumers == 1 && value != last + 1)
+                    ordered = false;
+                last = value;
+                mine += value;
+                received.fetch_add(1, memory_order_relaxed);
+            }
+            sum += mine;
+        });
+    for (thread& t: threads)
+        t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if (sum != producers * (perProducer * (perProducer + 1) / 2) || !ordered) {
+        cerr << "FAILED: values lost or out of order" << endl;
+        failures++;
+    }
+    return total / seconds;
+}
+
+template <typename Q>
+void report(const string& name, int producers, int consumers, long handoffs) {
+    Q q;
+    double rate = run(q, producers, consumers, handoffs / producers);
+    cout << left << setw(16) << name << producers << "P/" << consumers << "C  "
+         << right << setw(8) << fixed << setprecision(2) << rate / 1e6 << " M hand-offs/s" << endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    long handoffs = argc > 1 ? atol(argv[1]) : 2000000;
+    int cores = (int)max(thread::hardware_concurrency(), 1u);
+    int pairs = argc > 2 ? atoi(argv[2]) : max(cores / 2, 1);
+    cout << handoffs << " hand-offs, " << cores << " hardware threads" << endl;
+
+    report<QueueSPSC<long>>("QueueSPSC", 1, 1, handoffs);
+    report<QueueMPMC<long>>("QueueMPMC", 1, 1, handoffs);
+    report<LockedQueue>("QueueL + mutex", 1, 1, handoffs);
+    if (pairs > 1) {
+        report<QueueMPMC<long>>("QueueMPMC", pairs, pairs, handoffs);
+        report<LockedQueue>("QueueL + mutex", pairs, pairs, handoffs);
+    }
+
+    if (failures != 0) {
+        cout << failures << " runs failed" << endl;
+        return 1;
+    }
+    return 0;
+}
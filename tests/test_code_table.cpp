@@ -0,0 +1,175 @@
+/**
+ * @file tests/test_code_table.cpp - CodeTable::encode() against encodeScalar().
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ *
+ * encode() takes the AVX2 kernel where the processor has it, which merges eight codes at
+ * a time and packs pairs of pairs when no code is over 16 bits. For random models (a few
+ * characters or all 256, codes up to 16 bits, and Fibonacci-like counts that push codes
+ * to the full 32 bits) and inputs of every length up to a few hundred characters plus
+ * some long ones, the two must write the same bits, byte for byte, and agree on which
+ * inputs to reject: a character with no code, or an output buffer that is too small.
+ *
+ * Without AVX2 encode() is encodeScalar() and the checks pass trivially; the program says
+ * so. usage: test_code_table [models]
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Huffman.h"
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const string& what) {
+    if (!ok) {
+        cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+/*
+ * Counts for model m: a handful of characters, all of them, or Fibonacci-like counts
+ * (each about the sum of the two before) that give the longest codes allowed.
+ */
+void makeFrequencies(int m, mt19937_64& random, uint64_t frequencies[]) {
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        frequencies[c] = 0;
+    switch (m % 3) {
+    case 0:
+        for (int k = 0, count = 2 + random() % 20; k < count; k++)
+            frequencies[random() % (Huffman::MAX_CHAR + 1)] = 1 + random() % 1000;
+        break;
+    case 1:
+        for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+            frequencies[c] = 1 + random() % 100000;
+        break;
+    default:
+        uint64_t a = 1, b = 1;
+        for (int k = 0; k < 60; k++) {
+            frequencies[random() % (Huffman::MAX_CHAR + 1)] += a;
+            uint64_t next = a + b + random() % 2;
+            a = b;
+            b = next;
+        }
+    }
+}
+
+/*
+ * Text of n characters drawn from those that have codes, long codes as often as short.
+ */
+string makeText(const CodeTable& table, size_t n, mt19937_64& random) {
+    vector<char> alphabet;
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        if (table.codeLength((uint8_t)c) != 0)
+            alphabet.push_back((char)c);
+    string text(n, '\0');
+    for (size_t i = 0; i < n; i++)
+        text[i] = alphabet[random() % alphabet.size()];
+    return text;
+}
+
+/*
+ * Run one of the encoders, noting which exception (if any) it threw.
+ */
+template <typename Encode>
+size_t run(Encode encode, const string& text, vector<uint8_t>& dst, size_t cap, string& error) {
+    error.clear();
+    try {
+        return encode((const uint8_t *)text.data(), text.size(), dst.data(), cap);
+    } catch (const invalid_argument&) {
+        error = "invalid_argument";
+    } catch (const length_error&) {
+        error = "length_error";
+    }
+    return 0;
+}
+
+/*
+ * Both encoders on text with an output buffer of cap bytes.
+ * @return  whether they agree
+ */
+bool same(const CodeTable& table, const string& text, size_t cap) {
+    vector<uint8_t> fast(table.encodedBound(text.size()) + 8, 0xa5);
+    vector<uint8_t> scalar(fast.size(), 0xa5);
+    string fastError, scalarError;
+    size_t fastBits = run([&](const uint8_t *s, size_t n, uint8_t *d, size_t c) { return table.encode(s, n, d, c); },
+                          text, fast, cap, fastError);
+    size_t scalarBits = run([&](const uint8_t *s, size_t n, uint8_t *d, size_t c) {
+                                return table.encodeScalar(s, n, d, c); },
+                            text, scalar, cap, scalarError);
+    if (fastError != scalarError)
+        return false;
+    if (!fastError.empty())
+        return true;
+    return fastBits == scalarBits && memcmp(fast.data(), scalar.data(), (fastBits + 7) / 8) == 0;
+}
+
+void checkModel(int m, mt19937_64& random, int& longest) {
+    uint64_t frequencies[Huffman::MAX_CHAR+1];
+    makeFrequencies(m, random, frequencies);
+    Huffman model(frequencies);
+    const CodeTable& table = model.codeTable();
+    int maxLength = 0;
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        maxLength = max(maxLength, table.codeLength((uint8_t)c));
+    longest = max(longest, maxLength);
+    string name = "model " + to_string(m) + " (codes up to " + to_string(maxLength) + " bits)";
+
+    for (size_t n = 0; n <= 300; n++) {
+        string text = makeText(table, n, random);
+        if (!same(table, text, table.encodedBound(n))) {
+            check(false, name + ": " + to_string(n) + " characters");
+            return;
+        }
+    }
+    for (size_t n: {4093, 65536 + 5, 100003}) {
+        string text = makeText(table, n, random);
+        check(same(table, text, table.encodedBound(n)), name + ": " + to_string(n) + " characters");
+    }
+
+    // the same rejections: a character with no code at any position, a buffer too small
+    string text = makeText(table, 77, random);
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        if (table.codeLength((uint8_t)c) == 0) {
+            for (size_t at: {0, 7, 8, 40, 76}) {
+                string bad = text;
+                bad[at] = (char)c;
+                check(same(table, bad, table.encodedBound(bad.size())),
+                      name + ": character with no code at " + to_string(at));
+            }
+            break;
+        }
+    vector<uint8_t> dst(table.encodedBound(text.size()));
+    size_t bytes = (table.encode((const uint8_t *)text.data(), text.size(), dst.data(), dst.size()) + 7) / 8;
+    for (size_t cap: {(size_t)0, bytes / 2, bytes - 1, bytes})
+        check(same(table, text, cap), name + ": output buffer of " + to_string(cap) + " bytes");
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    int models = argc > 1 ? atoi(argv[1]) : 60;
+    if (!CodeTable::vectorized())
+        cout << "no AVX2 on this processor: encode() is encodeScalar()" << endl;
+    mt19937_64 random(40);
+    int longest = 0;
+    for (int m = 0; m < models; m++)
+        checkModel(m, random, longest);
+    check(models < 3 || longest == Bits::MAX_BITS, "some model has " + to_string(Bits::MAX_BITS) + "-bit codes");
+
+    if (failures != 0) {
+        cout << failures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all checks passed" << endl;
+    return 0;
+}
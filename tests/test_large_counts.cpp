@@ -0,0 +1,195 @@
+/**
+ * @file tests/test_large_counts.cpp - Huffman and BlockSort on an input with a character
+ *       seen more than 2^32 times.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ *
+ * The input is generated on the fly, so nothing near its size is ever held in memory:
+ * mostly 'a', with a 'b' every B_EVERY characters and a 'c' every C_EVERY. The test checks
+ *  1. a Huffman model sampled from the whole stream has the exact 64-bit counts,
+ *  2. its codes are a prefix code with 'a' getting the single-bit code, and the counts
+ *     survive writeFrequencies()/readFrequencies(),
+ *  3. every character of the stream round-trips through the model's codes,
+ *  4. the stream round-trips through BlockSort compress()/decompress().
+ *
+ * usage: test_large_counts [characters [threads]]
+ * The default is 2^32 + 2^20 characters, the smallest size that overflows 32-bit counts;
+ * the BlockSort pass is the slow part (tens of minutes on one core), so threads defaults
+ * to every core. A smaller size runs the same checks except the one that the count of
+ * 'a' is over UINT32_MAX.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BlockSort.h"
+#include "Huffman.h"
+using namespace std;
+
+namespace {
+
+const uint64_t B_EVERY = 1 << 16;
+const uint64_t C_EVERY = (1 << 20) + 7;
+
+char generated(uint64_t i) {
+    if (i % C_EVERY == C_EVERY - 1)
+        return 'c';
+    if (i % B_EVERY == B_EVERY - 1)
+        return 'b';
+    return 'a';
+}
+
+/*
+ * An input stream buffer that produces the first n generated characters, counting them.
+ */
+class GeneratorBuf : public streambuf {
+public:
+    uint64_t counts[Huffman::MAX_CHAR+1] = {};
+
+    explicit GeneratorBuf(uint64_t n) : left(n), next(0) {}
+
+protected:
+    int underflow() override {
+        if (left == 0)
+            return EOF;
+        size_t n = (size_t)min<uint64_t>(left, sizeof(buffer));
+        for (size_t i = 0; i < n; i++) {
+            buffer[i] = generated(next + i);
+            counts[(unsigned char)buffer[i]]++;
+        }
+        next += n;
+        left -= n;
+        setg(buffer, buffer, buffer + n);
+        return (unsigned char)buffer[0];
+    }
+
+private:
+    char buffer[1 << 16];
+    uint64_t left;
+    uint64_t next;
+};
+
+/*
+ * An output stream buffer that compares what is written with the generated characters.
+ */
+class CheckingBuf : public streambuf {
+public:
+    uint64_t count = 0;
+    bool same = true;
+
+protected:
+    int overflow(int c) override {
+        if (c != EOF)
+            same = same && (char)c == generated(count++);
+        return c == EOF ? 0 : c;
+    }
+
+    streamsize xsputn(const char *s, streamsize n) override {
+        for (streamsize i = 0; i < n; i++)
+            same = same && s[i] == generated(count + i);
+        count += n;
+        return n;
+    }
+};
+
+int failures = 0;
+
+void check(bool ok, const string& what) {
+    if (!ok) {
+        cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+void checkModel(const Huffman& model, const uint64_t expected[], uint64_t n) {
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        check(model.getFrequency((unsigned char)c) == expected[c],
+              "count of character " + to_string(c));
+    if (n > UINT32_MAX)
+        check(model.getFrequency('a') > UINT32_MAX, "count of 'a' is over UINT32_MAX");
+
+    // the codes of the characters present: 'a' has one bit, and none is a prefix of another
+    check(model.getCode('a').bitsUsed() == 1, "'a' has a one-bit code");
+    vector<Bits> codes;
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        if (expected[c] != 0)
+            codes.push_back(model.getCode((unsigned char)c));
+    for (size_t i = 0; i < codes.size(); i++)
+        for (size_t j = 0; j < codes.size(); j++) {
+            if (i == j || codes[i].bitsUsed() > codes[j].bitsUsed())
+                continue;
+            int length = codes[i].bitsUsed();
+            uint64_t mask = (uint64_t(1) << length) - 1;
+            check((codes[i].peekBits(length) & mask) != (codes[j].peekBits(length) & mask),
+                  "codes are prefix-free");
+        }
+
+    ostringstream saved;
+    model.writeFrequencies(saved);
+    istringstream in(saved.str());
+    uint64_t loaded[Huffman::MAX_CHAR+1];
+    Huffman::readFrequencies(in, loaded);
+    check(memcmp(loaded, expected, sizeof(loaded)) == 0, "counts survive writeFrequencies()");
+}
+
+void checkHuffmanRoundTrip(const Huffman& model, uint64_t n) {
+    const size_t CHUNK = 1 << 20;
+    string text(CHUNK, '\0'), decoded(CHUNK, '\0');
+    vector<uint8_t> coded(model.encodedBound(CHUNK));
+    for (uint64_t start = 0; start < n; start += CHUNK) {
+        size_t length = (size_t)min<uint64_t>(CHUNK, n - start);
+        for (size_t i = 0; i < length; i++)
+            text[i] = generated(start + i);
+        size_t bits = model.encode((const uint8_t *)text.data(), length, coded.data(), coded.size());
+        size_t count = model.decode(coded.data(), bits, (uint8_t *)&decoded[0], length);
+        if (count != length || memcmp(text.data(), decoded.data(), length) != 0) {
+            check(false, "Huffman round trip of characters from " + to_string(start));
+            return;
+        }
+    }
+}
+
+void checkBlockSortRoundTrip(uint64_t n, int threads) {
+    BlockSort sorter(BlockSort::DEFAULT_BLOCK_SIZE, threads);
+    GeneratorBuf source(n);
+    istream in(&source);
+    stringstream compressed;
+    sorter.compress(in, compressed);
+
+    CheckingBuf sink;
+    ostream out(&sink);
+    sorter.decompress(compressed, out);
+    check(sink.count == n, "BlockSort round trip length");
+    check(sink.same, "BlockSort round trip text");
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : (uint64_t(1) << 32) + (1 << 20);
+    int threads = argc > 2 ? atoi(argv[2]) : (int)max(thread::hardware_concurrency(), 1u);
+
+    GeneratorBuf source(n);
+    istream in(&source);
+    Huffman model(in);
+    checkModel(model, source.counts, n);
+    cout << "sampled " << n << " characters, 'a' " << model.getFrequency('a') << " times" << endl;
+
+    checkHuffmanRoundTrip(model, n);
+    cout << "Huffman round trip done" << endl;
+    checkBlockSortRoundTrip(n, threads);
+    cout << "BlockSort round trip done" << endl;
+
+    if (failures != 0) {
+        cout << failures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all checks passed" << endl;
+    return 0;
+}
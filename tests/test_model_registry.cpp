@@ -0,0 +1,206 @@
+/**
+ * @file tests/test_model_registry.cpp - ModelRegistry eviction and mapped-file checks.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ *
+ * Checks that
+ *  1. tables built from frequencies and tables mapped from a file are dropped least recently
+ *     used first once they take more than the budget, while a caller still holding one
+ *     keeps it, and that they code the same as the models they came from;
+ *  2. mapFile() rejects a file whose tables have been damaged: out-of-range tree and lookup
+ *     indexes, a cycle in the tree, code lengths over Bits::MAX_BITS, a truncated file, and
+ *     single bytes changed anywhere in the codes, lookup table and tree.
+ *
+ * Writes test_model_registry.tmp in the current directory (removed at the end).
+ * POSIX only (mmap). usage: test_model_registry
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ModelRegistry.h"
+using namespace std;
+
+namespace {
+
+const string FILENAME = "test_model_registry.tmp";
+
+int failures = 0;
+
+void check(bool ok, const string& what) {
+    if (!ok) {
+        cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+/*
+ * Frequencies that differ from model to model, some giving long codes.
+ */
+void makeFrequencies(int model, uint64_t frequencies[]) {
+    mt19937_64 random(model);
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        frequencies[c] = c % (model + 2) == 0 ? 0 : 1 + random() % (uint64_t(1) << (c % 30));
+    frequencies['a'] = 1;
+}
+
+string readFile(const string& filename) {
+    ifstream f(filename, ios::binary);
+    return string(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+}
+
+void writeFile(const string& filename, const string& bytes) {
+    ofstream f(filename, ios::binary | ios::trunc);
+    f.write(bytes.data(), bytes.size());
+}
+
+bool codesSame(const CodeTable& table, const Huffman& model) {
+    string text;
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        if (model.getFrequency((unsigned char)c) != 0)
+            text += string(3, (char)c);
+    vector<uint8_t> expected(model.encodedBound(text.size())), actual(table.encodedBound(text.size()));
+    size_t bits = model.encode((const uint8_t *)text.data(), text.size(), expected.data(), expected.size());
+    return table.encode((const uint8_t *)text.data(), text.size(), actual.data(), actual.size()) == bits &&
+           memcmp(expected.data(), actual.data(), (bits + 7) / 8) == 0;
+}
+
+void checkEviction() {
+    const size_t KEEP = 3;
+    ModelRegistry registry(KEEP * sizeof(CodeTable));
+    vector<unique_ptr<Huffman>> models;
+    for (int m = 0; m < 8; m++) {
+        uint64_t frequencies[Huffman::MAX_CHAR+1];
+        makeFrequencies(m, frequencies);
+        models.emplace_back(new Huffman(frequencies));
+        if (m < 4)
+            registry.add(m, frequencies);
+    }
+    vector<pair<uint64_t, const Huffman *>> mapped;
+    for (int m = 4; m < 8; m++)
+        mapped.push_back(make_pair((uint64_t)m, models[m].get()));
+    ModelRegistry::writeTables(FILENAME, mapped);
+    registry.mapFile(FILENAME);
+
+    // 0, 1, 2 fill the budget; using 0 again leaves 1 least recently used
+    weak_ptr<const CodeTable> first = registry.get(0), second = registry.get(1);
+    registry.get(2);
+    check(registry.memoryUsed() == KEEP * sizeof(CodeTable), "tables up to the budget are kept");
+    registry.get(0);
+    registry.get(4);
+    check(registry.memoryUsed() == KEEP * sizeof(CodeTable), "the budget is kept to");
+    check(second.expired(), "the least recently used table is dropped");
+    check(!first.expired(), "a recently used table is kept");
+
+    // a table held by the caller survives being dropped
+    shared_ptr<const CodeTable> held = registry.get(5);
+    for (int m = 0; m < 4; m++)
+        registry.get(m);
+    check(registry.memoryUsed() <= KEEP * sizeof(CodeTable), "the budget is kept to with mapped tables");
+    check(codesSame(*held, *models[5]), "a dropped table held by the caller still codes");
+
+    for (int m = 0; m < 8; m++)
+        check(codesSame(*registry.get(m), *models[m]), "table " + to_string(m) + " codes as its model");
+    bool unknown = false;
+    try {
+        registry.get(99);
+    } catch (const out_of_range&) {
+        unknown = true;
+    }
+    check(unknown, "an unregistered ID is out of range");
+}
+
+/*
+ * Whether mapFile() rejects the bytes of a table file.
+ */
+bool rejected(const string& bytes) {
+    writeFile(FILENAME, bytes);
+    ModelRegistry registry;
+    try {
+        registry.mapFile(FILENAME);
+    } catch (const invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+void put16(string& bytes, size_t at, uint16_t value) {
+    memcpy(&bytes[at], &value, sizeof(value));
+}
+
+void checkCorruptFiles() {
+    uint64_t frequencies[Huffman::MAX_CHAR+1];
+    makeFrequencies(1, frequencies);
+    Huffman model(frequencies);
+    ModelRegistry::writeTables(FILENAME, {make_pair((uint64_t)1, &model)});
+    string good = readFile(FILENAME);
+    check(!rejected(good), "an intact file maps");
+
+    // the table's place in the file (after the 16-byte header: id, then offset), and the
+    // places of its first three members, which have no padding between them
+    uint64_t table;
+    memcpy(&table, &good[16 + 8], sizeof(table));
+    const size_t CODES = table;                                           // {bits, length} x 256
+    const size_t LOOKUP = CODES + (Huffman::MAX_CHAR+1) * 8;              // {value, length, valid}
+    const size_t TREE = LOOKUP + (1 << CodeTable::LOOKUP_BITS) * 4;       // [256][2] uint16
+    const size_t END = TREE + (Huffman::MAX_CHAR+1) * 4;
+    check(END <= table + sizeof(CodeTable), "the table layout is as expected");
+
+    string bad = good;
+    uint32_t length = 200;
+    memcpy(&bad[CODES + 8 * 'b' + 4], &length, sizeof(length));
+    check(rejected(bad), "a code length over Bits::MAX_BITS is rejected");
+
+    bad = good;
+    for (size_t i = 0; i < (1u << CodeTable::LOOKUP_BITS); i++)
+        if (bad[LOOKUP + 4 * i + 2] == 0 && bad[LOOKUP + 4 * i + 3] != 0) {  // a long code's entry
+            put16(bad, LOOKUP + 4 * i, 0x7fff);
+            break;
+        }
+    check(bad != good, "the model has codes longer than the lookup");
+    check(rejected(bad), "a lookup index past the tree is rejected");
+
+    bad = good;
+    put16(bad, TREE + 4 * 1, 0x7fff);
+    check(rejected(bad), "a tree index past the tree is rejected");
+
+    bad = good;
+    put16(bad, TREE + 4 * 1, 1);
+    put16(bad, TREE + 4 * 1 + 2, 1);
+    check(rejected(bad), "a cycle in the tree is rejected");
+
+    check(rejected(good.substr(0, table + sizeof(CodeTable) - 1)), "a truncated file is rejected");
+
+    mt19937 random(36);
+    int missed = 0;
+    for (int trial = 0; trial < 300; trial++) {
+        bad = good;
+        size_t at = CODES + random() % (END - CODES);
+        bad[at] ^= (char)(1 + random() % 255);
+        if (!rejected(bad))
+            missed++;
+    }
+    check(missed == 0, to_string(missed) + " changed bytes were not noticed");
+}
+
+}
+
+int main() {
+    checkEviction();
+    checkCorruptFiles();
+    remove(FILENAME.c_str());
+
+    if (failures != 0) {
+        cout << failures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all checks passed" << endl;
+    return 0;
+}
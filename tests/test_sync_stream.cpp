@@ -0,0 +1,342 @@
+/**
+ * @file tests/test_sync_stream.cpp - SyncEncoder/SyncDecoder over a socket.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ *
+ * A client codes messages with a SyncEncoder, flushing after each one, and sends them down
+ * one end of a socketpair; a server thread feeds what it receives to a SyncDecoder and
+ * echoes the text of each segment back as soon as it is decoded. The client waits for each
+ * echo before sending the next message, so a decoder that held a segment back until more
+ * bytes came would never answer (the client gives up after a few seconds). The server
+ * reads one byte at a time in one pass and pieces of random size in another.
+ *
+ * Also checked: a flush with nothing written is a segment of no text, every segment of a
+ * long stream cut into random pieces decodes, a segment whose marker is damaged is
+ * rejected, and a chunk with a character the model cannot code is rejected whole, leaving
+ * the segment it was written into intact. Last, the round-trip time of coded and uncoded echoes is printed (p50/p99).
+ *
+ * POSIX only (socketpair). usage: test_sync_stream [messages]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "StreamCodec.h"
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const string& what) {
+    if (!ok) {
+        cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+/*
+ * Messages of 0 to 300 characters made of words, some of them empty.
+ */
+vector<string> makeMessages(size_t count, mt19937& random) {
+    static const char *words[] = {
+        "the", "of", "and", "to", "in", "is", "that", "for", "it", "as", "was", "with",
+        "order", "price", "quantity", "symbol", "account", "status", "filled", "cancel",
+        "{", "}", ":", ",", "\"id\"", "\"ts\"", "0", "1", "42", "3.14", "2018-04-01"
+    };
+    const size_t WORDS = sizeof(words) / sizeof(words[0]);
+    vector<string> messages;
+    for (size_t i = 0; i < count; i++) {
+        string m;
+        size_t length = i % 97 == 0 ? 0 : random() % 300;
+        while (m.size() < length)
+            m += string(words[random() % WORDS]) + (random() % 4 == 0 ? "\n" : " ");
+        messages.push_back(m.substr(0, length));
+    }
+    return messages;
+}
+
+/*
+ * A model of the messages' text that can also code any other character.
+ */
+Huffman::Shared makeModel(const vector<string>& messages) {
+    uint64_t frequencies[Huffman::MAX_CHAR+1];
+    for (int c = 0; c <= Huffman::MAX_CHAR; c++)
+        frequencies[c] = 1;
+    for (const string& m: messages)
+        for (char c: m)
+            frequencies[(unsigned char)c]++;
+    return Huffman::share(frequencies);
+}
+
+void sendAll(int fd, const char *data, size_t n) {
+    while (n > 0) {
+        ssize_t sent = send(fd, data, n, 0);
+        if (sent <= 0)
+            throw runtime_error("send failed");
+        data += sent;
+        n -= sent;
+    }
+}
+
+/*
+ * Receive exactly n bytes, or false if the peer closed or the receive timed out.
+ */
+bool receiveAll(int fd, char *data, size_t n) {
+    while (n > 0) {
+        ssize_t got = recv(fd, data, n, 0);
+        if (got <= 0)
+            return false;
+        data += got;
+        n -= got;
+    }
+    return true;
+}
+
+/*
+ * Echo back the text of each segment as it completes: uint32 length, then the text.
+ */
+void serve(int fd, const Huffman& model, bool oneByte, unsigned seed) {
+    mt19937 random(seed);
+    SyncDecoder decoder(model);
+    char buffer[256];
+    string text;
+    for (;;) {
+        size_t want = oneByte ? 1 : 1 + random() % sizeof(buffer);
+        ssize_t got = recv(fd, buffer, want, 0);
+        if (got <= 0)
+            return;
+        text.clear();
+        size_t segments;
+        try {
+            segments = decoder.write((const uint8_t *)buffer, got, text);
+        } catch (const invalid_argument&) {
+            return;  // the client sees no echo and reports it
+        }
+        for (size_t s = 0; s < segments; s++) {
+            // one message per segment, so the text of a completed read is all one message
+            uint32_t length = (uint32_t)text.size();
+            sendAll(fd, (const char *)&length, sizeof(length));
+            sendAll(fd, text.data(), text.size());
+            if (!decoder.idle())
+                return;
+        }
+    }
+}
+
+/*
+ * Same as serve() without any coding: a length, then the text, echoed as received.
+ */
+void serveRaw(int fd) {
+    string text;
+    for (;;) {
+        uint32_t length;
+        if (!receiveAll(fd, (char *)&length, sizeof(length)))
+            return;
+        text.resize(length);
+        if (length != 0 && !receiveAll(fd, &text[0], length))
+            return;
+        sendAll(fd, (const char *)&length, sizeof(length));
+        sendAll(fd, text.data(), text.size());
+    }
+}
+
+/*
+ * Send each message and wait for its echo.
+ * @return  round-trip times in microseconds
+ */
+vector<double> exchange(const vector<string>& messages, const Huffman *model, bool oneByte, unsigned seed,
+                        const string& name) {
+    int ends[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0)
+        throw runtime_error("socketpair failed");
+    timeval timeout = {5, 0};
+    setsockopt(ends[0], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    thread server([&]() {
+        if (model != nullptr)
+            serve(ends[1], *model, oneByte, seed);
+        else
+            serveRaw(ends[1]);
+    });
+
+    vector<double> times;
+    string wire, echo;
+    unique_ptr<SyncEncoder> encoder(model != nullptr ? new SyncEncoder(*model) : nullptr);
+    for (size_t i = 0; i < messages.size(); i++) {
+        const string& m = messages[i];
+        auto start = chrono::steady_clock::now();
+        wire.clear();
+        if (model != nullptr) {
+            encoder->write((const uint8_t *)m.data(), m.size());
+            encoder->flush(wire);
+        } else {
+            uint32_t length = (uint32_t)m.size();
+            wire.assign((const char *)&length, sizeof(length));
+            wire += m;
+        }
+        sendAll(ends[0], wire.data(), wire.size());
+        uint32_t length;
+        bool answered = receiveAll(ends[0], (char *)&length, sizeof(length));
+        if (answered) {
+            echo.resize(length);
+            answered = length == 0 || receiveAll(ends[0], &echo[0], length);
+        }
+        times.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        if (!answered || echo != m) {
+            check(false, name + ": message " + to_string(i) + (answered ? " echoed wrong" : " not decoded on arrival"));
+            break;
+        }
+    }
+    shutdown(ends[0], SHUT_RDWR);
+    server.join();
+    close(ends[0]);
+    close(ends[1]);
+    return times;
+}
+
+void checkEmptyFlush(const Huffman& model) {
+    SyncEncoder encoder(model);
+    SyncDecoder decoder(model);
+    string wire, text;
+    encoder.flush(wire);
+    check(!wire.empty() && (uint8_t)wire[0] == SyncEncoder::SYNC_MARKER, "an empty flush makes a segment");
+    check(decoder.write((const uint8_t *)wire.data(), wire.size(), text) == 1 && text.empty() && decoder.idle(),
+          "an empty segment decodes to no text");
+
+    // and does not disturb the segments around it
+    wire.clear();
+    encoder.write((const uint8_t *)"abc", 3);
+    encoder.flush(wire);
+    encoder.flush(wire);
+    encoder.write((const uint8_t *)"de", 2);
+    encoder.flush(wire);
+    check(decoder.write((const uint8_t *)wire.data(), wire.size(), text) == 3 && text == "abcde",
+          "segments either side of an empty one");
+}
+
+void checkRandomPieces(const Huffman& model, const vector<string>& messages, mt19937& random) {
+    SyncEncoder encoder(model);
+    string wire, all;
+    for (const string& m: messages) {
+        size_t half = m.size() / 2;
+        encoder.write((const uint8_t *)m.data(), half);
+        encoder.write((const uint8_t *)m.data() + half, m.size() - half);
+        encoder.flush(wire);
+        all += m;
+    }
+    SyncDecoder decoder(model);
+    string text;
+    size_t segments = 0;
+    for (size_t at = 0; at < wire.size(); ) {
+        size_t n = min(wire.size() - at, (size_t)(1 + random() % 50));
+        segments += decoder.write((const uint8_t *)wire.data() + at, n, text);
+        at += n;
+    }
+    check(segments == messages.size(), "every segment of a stream in random pieces completes");
+    check(text == all && decoder.idle(), "a stream in random pieces decodes");
+}
+
+void checkCorruptMarker(const Huffman& model) {
+    SyncEncoder encoder(model);
+    string wire;
+    encoder.write((const uint8_t *)"hello", 5);
+    encoder.flush(wire);
+    size_t first = wire.size();
+    encoder.write((const uint8_t *)"world", 5);
+    encoder.flush(wire);
+
+    string bad = wire, text;
+    bad[0] ^= 0xff;
+    SyncDecoder decoder(model);
+    bool rejected = false;
+    try {
+        decoder.write((const uint8_t *)bad.data(), bad.size(), text);
+    } catch (const invalid_argument&) {
+        rejected = true;
+    }
+    check(rejected, "a damaged first marker is rejected");
+
+    // a damaged marker after a good segment: the good one is still decoded first
+    bad = wire;
+    bad[first] ^= 0xff;
+    SyncDecoder later(model);
+    text.clear();
+    rejected = false;
+    try {
+        later.write((const uint8_t *)bad.data(), first, text);
+        later.write((const uint8_t *)bad.data() + first, bad.size() - first, text);
+    } catch (const invalid_argument&) {
+        rejected = true;
+    }
+    check(rejected && text == "hello", "a damaged later marker is rejected");
+}
+
+void checkUncodableCharacter() {
+    // a model without '\x01', so a chunk with one fails partway through
+    istringstream sample("helloworldagain");
+    Huffman model(sample);
+    SyncEncoder encoder(model);
+    string wire;
+    encoder.write((const uint8_t *)"hello", 5);
+    bool rejected = false;
+    try {
+        encoder.write((const uint8_t *)"world\x01", 6);
+    } catch (const invalid_argument&) {
+        rejected = true;
+    }
+    check(rejected, "a character with no code is rejected");
+    encoder.write((const uint8_t *)"again", 5);
+    encoder.flush(wire);
+
+    SyncDecoder decoder(model);
+    string text;
+    check(decoder.write((const uint8_t *)wire.data(), wire.size(), text) == 1 && text == "helloagain"
+          && decoder.idle(), "a rejected chunk leaves the segment as it was");
+}
+
+void printLatency(const string& name, vector<double> times) {
+    if (times.empty())
+        return;
+    sort(times.begin(), times.end());
+    cout << name << " round trip: p50 " << times[times.size() / 2] << " us, p99 "
+         << times[times.size() * 99 / 100] << " us" << endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000;
+    mt19937 random(2018);
+    vector<string> messages = makeMessages(count, random);
+    Huffman::Shared model = makeModel(messages);
+
+    checkEmptyFlush(*model);
+    checkRandomPieces(*model, messages, random);
+    checkCorruptMarker(*model);
+    checkUncodableCharacter();
+    exchange(messages, model.get(), true, 1, "one-byte reads");
+    vector<double> coded = exchange(messages, model.get(), false, 2, "random reads");
+    vector<double> raw = exchange(messages, nullptr, false, 3, "uncoded");
+    printLatency("coded", coded);
+    printLatency("uncoded", raw);
+
+    if (failures != 0) {
+        cout << failures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file train.cpp - Train a ModelSet on a corpus of files.
+ * @author Rajiv Singireddy
+ * @see "Seattle University, CPSC2430, Spring 2018"
+ *
+ * usage: train models.dat k file...
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ModelSet.h"
+#include "CompressibilityProbe.h"
+
+using namespace std;
+
+namespace {
+
+// more models than this would each be trained on almost nothing
+const int MAX_MODELS = 1 << 16;
+
+int parseInt(const string& text, int lo, int hi, const string& what) {
+    char *end;
+    long n = strtol(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0' || n < lo || n > hi)
+        throw invalid_argument("bad " + what + " " + text);
+    return (int)n;
+}
+
+int train(int argc, char *argv[]) {
+    string fnmodels = argv[1];
+    int k = parseInt(argv[2], 1, MAX_MODELS, "model count");
+
+    /*
+     * One histogram per file of the corpus
+     */
+    vector<ModelSet::Histogram> corpus;
+    uint64_t rawBits = 0, ownBits = 0;
+    for (int i = 3; i < argc; i++) {
+        ifstream in(argv[i], ios::binary);
+        if (!in)
+            throw invalid_argument(string("cannot read ") + argv[i]);
+        ModelSet::Histogram h = {};
+        ModelSet::count(in, h);
+        for (uint64_t n: h)
+            rawBits += 8 * n;
+        ownBits += CompressibilityProbe::huffmanBits(h.data());
+        corpus.push_back(h);
+    }
+
+    /*
+     * Cluster into k models and save them
+     * @post  expect the trained total to fall between one model for everything and one per file
+     */
+    ModelSet single = ModelSet::train(corpus, 1);
+    ModelSet models = ModelSet::train(corpus, k);
+    models.writeToFile(fnmodels);
+
+    cout << corpus.size() << " files, " << rawBits / 8 << " bytes" << endl;
+    cout << "one model:          " << single.cost(corpus) / 8 << " bytes" << endl;
+    cout << models.size() << " models:           " << models.cost(corpus) / 8 << " bytes" << endl;
+    cout << "one model per file: " << ownBits / 8 << " bytes (plus a table per file)" << endl;
+    return 0;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        cerr << "usage: " << argv[0] << " models.dat k file..." << endl;
+        return 2;
+    }
+    try {
+        return train(argc, argv);
+    } catch (const exception& e) {
+        cerr << argv[0] << ": " << e.what() << endl;
+        return 1;
+    }
+}